@@ -0,0 +1,103 @@
+// AdditionChain.cpp - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+#include "Common.h"
+
+
+const int CAdditionChain::knSquare;
+
+
+// Every width from 1 to 6 is tried, and the cheapest kept; on a tie,
+// the narrower width, for its smaller table.
+
+CAdditionChain::CAdditionChain( const BigNum & b )
+	: m_nTableSize( 0 )
+{
+	vector<int> vSteps;
+	int nBestProducts = 0;
+	int nWidth;
+
+	for( nWidth = 1; nWidth <= 6; ++nWidth )
+	{
+		const int knTableSize = MakeSteps( b, nWidth, vSteps );
+		const int knProducts = CountProducts( knTableSize, vSteps );
+
+		if( nWidth == 1  ||  knProducts < nBestProducts )
+		{
+			nBestProducts = knProducts;
+			m_nTableSize = knTableSize;
+			m_vSteps.swap( vSteps );
+		}
+	}
+}
+
+
+// b's sliding windows of at most nWidth bits, from the top, each beginning
+// and ending with a 1 ("Handbook of Applied Cryptography", Algorithm 14.85).
+// Returns the number of table entries that the windows use.
+
+int CAdditionChain::MakeSteps( const BigNum & b, int nWidth, vector<int> & vSteps )
+{
+	int nTableSize = 0;
+	int i;
+	int j;
+
+	vSteps.clear();
+
+	for( i = b.NumSignificantBits() - 1; i >= 0; )
+	{
+
+		if( !b.TestBit( i ) )
+		{
+			vSteps.push_back( knSquare );
+			--i;
+			continue;
+		}
+
+		int nLow = ( i - nWidth + 1 > 0 ) ? i - nWidth + 1 : 0;
+		int nWindow = 0;
+
+		while( !b.TestBit( nLow ) )
+		{
+			++nLow;
+		}
+
+		for( j = i; j >= nLow; --j )
+		{
+			nWindow = ( nWindow << 1 ) | ( b.TestBit( j ) ? 1 : 0 );
+
+			// The first window just starts the result; there is nothing to square yet.
+
+			if( vSteps.size() > 0 )
+			{
+				vSteps.push_back( knSquare );
+			}
+		}
+
+		vSteps.push_back( nWindow >> 1 );
+
+		if( ( nWindow >> 1 ) + 1 > nTableSize )
+		{
+			nTableSize = ( nWindow >> 1 ) + 1;
+		}
+
+		i = nLow - 1;
+	}
+
+	return( nTableSize );
+}
+
+
+// The table is a, a^2, then a^3 onwards, one product each;
+// a alone costs nothing beyond the conversion into Montgomery form.
+
+int CAdditionChain::CountProducts( int nTableSize, const vector<int> & vSteps )
+{
+	const int knTableProducts = ( nTableSize > 1 ) ? nTableSize : 0;
+
+	return( knTableProducts + ( ( vSteps.size() > 0 ) ? (int)vSteps.size() - 1 : 0 ) );
+}
+
+
+// **** End of File ****
@@ -0,0 +1,110 @@
+// Arena.cpp - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+#include "Common.h"
+
+
+thread_local CBigNumArenaScope * CBigNumArenaScope::s_pCurrent = 0;
+
+
+CBigNumArena::CBigNumArena( void )
+	: m_nBlock( 0 ),
+		m_unOffset( 0 ),
+		m_unBytesInUse( 0 ),
+		m_unHighWaterMark( 0 ),
+		m_ullLastGeneration( 0 )
+{
+}
+
+
+CBigNumArena::~CBigNumArena( void )
+{
+	int i;
+
+	for( i = 0; i < (int)m_vBlocks.size(); ++i )
+	{
+		delete [] m_vBlocks[i].m_pMemory;
+	}
+}
+
+
+CBigNumArena & CBigNumArena::GetForThisThread( void )
+{
+	static thread_local CBigNumArena arena;
+
+	return( arena );
+}
+
+
+// The unused end of a block that is too small for a request is skipped,
+// and counted as in use; the block is used again once a scope releases it.
+
+void * CBigNumArena::Allocate( size_t unBytes )
+{
+	const size_t kunSize = ( unBytes + knArenaAlignment - 1 ) & ~( knArenaAlignment - 1 );
+
+	for( ; m_nBlock < (int)m_vBlocks.size(); ++m_nBlock, m_unOffset = 0 )
+	{
+		const CBlock & kBlock = m_vBlocks[m_nBlock];
+
+		if( kBlock.m_unSize - m_unOffset >= kunSize )
+		{
+			void * p = kBlock.m_pStart + m_unOffset;
+
+			m_unOffset += kunSize;
+			m_unBytesInUse += kunSize;
+
+			if( m_unBytesInUse > m_unHighWaterMark )
+			{
+				m_unHighWaterMark = m_unBytesInUse;
+			}
+
+			return( p );
+		}
+
+		m_unBytesInUse += kBlock.m_unSize - m_unOffset;
+	}
+
+	// Every block is full; add one at the end, where m_nBlock now points.
+	CBlock block;
+
+	block.m_unSize = ( kunSize > knArenaBlockSize ) ? kunSize : knArenaBlockSize;
+	block.m_pMemory = new unsigned char[block.m_unSize + knArenaAlignment - 1];
+	block.m_pStart = (unsigned char *)( ( (size_t)block.m_pMemory + knArenaAlignment - 1 ) & ~( knArenaAlignment - 1 ) );
+	m_vBlocks.push_back( block );
+	return( Allocate( unBytes ) );
+}
+
+
+CBigNumArenaScope::CBigNumArenaScope( void )
+	: m_arena( CBigNumArena::GetForThisThread() ),
+		m_pParent( s_pCurrent ),
+		m_ullGeneration( ++m_arena.m_ullLastGeneration ),
+		m_nBlock( m_arena.m_nBlock ),
+		m_unOffset( m_arena.m_unOffset ),
+		m_unBytesInUse( m_arena.m_unBytesInUse )
+{
+	s_pCurrent = this;
+}
+
+
+// Releases everything allocated since the scope began, in one step.
+
+CBigNumArenaScope::~CBigNumArenaScope( void )
+{
+	m_arena.m_nBlock = m_nBlock;
+	m_arena.m_unOffset = m_unOffset;
+	m_arena.m_unBytesInUse = m_unBytesInUse;
+	s_pCurrent = m_pParent;
+}
+
+
+void * CBigNumArenaScope::AllocateBytes( size_t unBytes )
+{
+	Assert( s_pCurrent == this );
+	return( m_arena.Allocate( unBytes ) );
+}
+
+
+// **** End of File ****
@@ -0,0 +1,81 @@
+// Barrett.cpp - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+#include "Common.h"
+
+
+CBarrettReducer::CBarrettReducer( const BigNum & n )
+	: m_n( n ),
+		m_nDigits( n.NumDigits() )
+{
+
+	if( n.IsZero() )
+	{
+		ThrowException();
+	}
+
+	// This is the only division the reducer ever performs.
+	BigNum bToThe2k( 1 );
+
+	bToThe2k <<= 2 * knBitsPerDigit * m_nDigits;
+	m_mu = bToThe2k / n;
+}
+
+
+// From the "Handbook of Applied Cryptography", Algorithm 14.42.
+// q3 = floor( floor( a / B^( k - 1 ) ) * mu / B^( k + 1 ) ) is at most
+// two less than floor( a / n ), so r = a - q3 * n is less than 3n;
+// only the low k + 1 digits of either term are needed to find it.
+
+BigNum CBarrettReducer::Reduce( const BigNum & a ) const
+{
+	const int knADigits = a.NumDigits();
+
+	if( a < m_n )
+	{
+		return( a );
+	}
+	else if( knADigits > 2 * m_nDigits )
+	{
+		return( a % m_n );
+	}
+
+	const int knRDigits = m_nDigits + 1;
+	const int knQ1Digits = knADigits - ( m_nDigits - 1 );
+	const int knMuDigits = m_mu.NumDigits();
+	const int knQ2Digits = knQ1Digits + knMuDigits;
+	const int knQ3Digits = knQ2Digits - knRDigits;
+	BigNum::DigitContainerType vQ2;
+	BigNum r;
+
+	vQ2.resize( knQ2Digits );
+	r.m_v.resize( knRDigits );
+
+	DigitsMultiply( &vQ2[0], &a.m_v[m_nDigits - 1], knQ1Digits, &m_mu.m_v[0], knMuDigits );
+
+	// r1 = a mod B^( k + 1 ).
+	memcpy( &r.m_v[0], &a.m_v[0], ( knADigits < knRDigits ? knADigits : knRDigits ) * sizeof( BigNumDigit ) );
+
+	if( knQ3Digits > 0 )
+	{
+		// r = r1 - q3 * n, mod B^( k + 1 ).
+		const int knQ3NDigits = knQ3Digits + m_nDigits;
+		BigNum::DigitContainerType vQ3N;
+
+		vQ3N.resize( knQ3NDigits );
+		DigitsMultiply( &vQ3N[0], &vQ2[knRDigits], knQ3Digits, &m_n.m_v[0], m_nDigits );
+		DigitsSubtract( &r.m_v[0], &r.m_v[0], knRDigits, &vQ3N[0], knQ3NDigits < knRDigits ? knQ3NDigits : knRDigits );
+	}
+
+	while( r.m_v[m_nDigits] != 0  ||  DigitsCompare( &r.m_v[0], &m_n.m_v[0], m_nDigits ) >= 0 )
+	{
+		DigitsSubtract( &r.m_v[0], &r.m_v[0], knRDigits, &m_n.m_v[0], m_nDigits );
+	}
+
+	r.DiscardLeadingZeros();
+	return( r );
+}
+
+
+// **** End of File ****
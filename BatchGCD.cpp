@@ -0,0 +1,89 @@
+// BatchGCD.cpp - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// The trees are stored level by level: level 0 holds the moduli, and node i
+// of each level above is the product of nodes 2i and 2i + 1 of the level below
+// (or a copy of node 2i, if it has no partner).  The top level has one node, P.
+
+// The multiplications and divisions are the subquadratic ones of DigitsMultiply()
+// and DigitsDivide(), so each level costs a small multiple of one product of
+// the size of P; there are log2( k ) levels.  Where k isn't a power of 2,
+// some remainders are reduced by nodes not much smaller than themselves;
+// DigitsDivide() handles those short quotients with one unbalanced product.
+
+#include "Common.h"
+
+
+void BatchGCD( const vector<BigNum> & vModuli, vector<BigNum> & vDivisors )
+{
+	const int knNumModuli = vModuli.size();
+	vector< vector<BigNum> > vvProducts( 1, vModuli );
+	vector<BigNum> vRemainders;
+	vector<BigNum> vChildRemainders;
+	int nLevel;
+	int i;
+
+	vDivisors.resize( knNumModuli );
+
+	if( knNumModuli == 0 )
+	{
+		return;
+	}
+
+	// The product tree.
+
+	while( vvProducts.back().size() > 1 )
+	{
+		const vector<BigNum> & kvBelow = vvProducts.back();
+		const int knBelow = kvBelow.size();
+		vector<BigNum> vAbove( ( knBelow + 1 ) / 2 );
+
+		for( i = 0; i < knBelow / 2; ++i )
+		{
+			vAbove[i] = kvBelow[2 * i] * kvBelow[2 * i + 1];
+		}
+
+		if( knBelow % 2 != 0 )
+		{
+			vAbove[knBelow / 2] = kvBelow[knBelow - 1];
+		}
+
+		// kvBelow is invalid once the level is pushed.
+		vvProducts.push_back( vector<BigNum>() );
+		vvProducts.back().swap( vAbove );
+	}
+
+	// The remainder tree: P mod node^2 at each node, computed from its parent's,
+	// since the parent's remainder is congruent to P modulo the parent's square,
+	// and so modulo the node's.  At the top, P mod P^2 is just P.
+	vRemainders = vvProducts.back();
+
+	for( nLevel = (int)vvProducts.size() - 2; nLevel >= 0; --nLevel )
+	{
+		const vector<BigNum> & kvNodes = vvProducts[nLevel];
+		const int knNodes = kvNodes.size();
+
+		vChildRemainders.resize( knNodes );
+
+		for( i = 0; i < knNodes; ++i )
+		{
+			vChildRemainders[i] = vRemainders[i / 2] % ( kvNodes[i] * kvNodes[i] );
+		}
+
+		vRemainders.swap( vChildRemainders );
+
+		// The level above is no longer needed.
+		vvProducts.pop_back();
+	}
+
+	// P mod n^2 is a multiple of n, since P is.
+
+	for( i = 0; i < knNumModuli; ++i )
+	{
+		vDivisors[i] = GCD( vModuli[i], vRemainders[i] / vModuli[i] );
+	}
+}
+
+
+// **** End of File ****
@@ -40,24 +40,50 @@ BigNum::BigNum( void )
 
 BigNum::BigNum( int nNumUShorts, const unsigned short * pusSrc )
 {
-	int i;
+	SetFromSegments( nNumUShorts, pusSrc );
+}
 
-	for( i = 0; i < nNumUShorts; ++i )
+
+BigNum::BigNum( unsigned long ulSrc )
+{
+	m_v.push_back( (BigNumDigit)ulSrc );
+	DiscardLeadingZeros();
+}
+
+
+// Returns the given 16-bit segment; segment 0 is the least significant.
+
+unsigned short BigNum::GetSegment( int nSegment ) const
+{
+	const int knDigit = nSegment / knSegmentsPerDigit;
+
+	if( nSegment < 0  ||  knDigit >= NumDigits() )
 	{
-		m_v.push_back( pusSrc[i] );
+		return( 0 );
 	}
 
-	DiscardLeadingZeros();
+	return( (unsigned short)( m_v[knDigit] >> ( ( nSegment % knSegmentsPerDigit ) * knBitsPerSegment ) ) );
 }
 
 
-BigNum::BigNum( unsigned long ulSrc )
+void BigNum::SetFromSegments( int nNumSegments, const unsigned short * pusSrc )
 {
-	const unsigned short kusLow = (unsigned short)( ulSrc & 0xFFFF );
-	const unsigned short kusHigh = (unsigned short)( ulSrc >> 16 );
+	int i;
+
+	m_v.clear();
+
+	for( i = 0; i < nNumSegments; ++i )
+	{
+		const int knShift = ( i % knSegmentsPerDigit ) * knBitsPerSegment;
+
+		if( knShift == 0 )
+		{
+			m_v.push_back( 0 );
+		}
+
+		m_v.back() |= (BigNumDigit)pusSrc[i] << knShift;
+	}
 
-	m_v.push_back( kusLow );
-	m_v.push_back( kusHigh );
 	DiscardLeadingZeros();
 }
 
@@ -71,10 +97,13 @@ void BigNum::HashWithString( const char * pcString )
 		return;
 	}
 
+	// The mask is applied one 16-bit segment at a time,
+	// so that hashed keys are the same as those written by older versions.
+	const int knNumSegments = NumSegments();
 	int i = 0;
-	DigitContainerType::iterator it = m_v.begin();
+	int nSegment;
 
-	for( ; it != m_v.end(); ++it )
+	for( nSegment = 0; nSegment < knNumSegments; ++nSegment )
 	{
 		const unsigned short kusLow = (unsigned short)pcString[i];
 
@@ -86,34 +115,322 @@ void BigNum::HashWithString( const char * pcString )
 
 		const unsigned short kusMask = ( kusHigh << 8 ) | kusLow;
 
-		*it ^= kusMask;
+		m_v[nSegment / knSegmentsPerDigit] ^= (BigNumDigit)kusMask << ( ( nSegment % knSegmentsPerDigit ) * knBitsPerSegment );
 	}
+
+	DiscardLeadingZeros();
 }
 
 
 void BigNum::PrintDecimal( void ) const
 {
-	DigitContainerType::const_reverse_iterator i = m_v.rbegin();
+	vector<char> vcText;
+
+	ToString( vcText, 10 );
+	printf( "%s\n", &vcText[0] );
+}
 
-	for( ; i != m_v.rend(); ++i )
+
+void BigNum::PrintHex( void ) const
+{
+	int i;
+
+	for( i = NumSegments() - 1; i >= 0; --i )
 	{
-		printf( "%u ", *i );
+		printf( "%04X ", GetSegment( i ) );
 	}
 
 	printf( "\n" );
 }
 
 
-void BigNum::PrintHex( void ) const
+// Radix conversion.
+// Decimal text is handled in chunks of knDecimalChunkChars digits, the most
+// that fit in one BigNumDigit.  Numbers of up to knRadixBaseCaseDigits digits
+// are converted a chunk at a time, which is quadratic; larger ones are split
+// in two at a power 10^( 19 * 2^k ), and the halves converted recursively.
+// The powers are computed once per conversion, by repeated squaring, and
+// used at every split of their level; so conversion costs a few full-size
+// divisions (printing) or multiplications (parsing) per level, of which
+// there are log n, and rides on the subquadratic multiplication and division.
+// Hexadecimal text is just the digits' bits, four to a character.
+
+static const int knDecimalChunkChars = 19;
+static const BigNumDigit kullDecimalChunk = 10000000000000000000ULL;	// 10^19
+static const int knRadixBaseCaseDigits = 32;
+
+
+// Appends the decimal text of x to vcDst, with leading zeros to make it
+// at least nWidth characters long; x must be less than vPowers[k]^2.
+
+void BigNum::AppendDecimal(
+	const BigNum & x, const vector<BigNum> & vPowers, int k, int nWidth,
+	vector<char> & vcDst )
 {
-	DigitContainerType::const_reverse_iterator i = m_v.rbegin();
 
-	for( ; i != m_v.rend(); ++i )
+	if( k < 0  ||  x.NumDigits() <= knRadixBaseCaseDigits )
 	{
-		printf( "%04X ", *i );
+		AppendDecimalChunks( x, nWidth, vcDst );
+		return;
 	}
 
-	printf( "\n" );
+	// The low half always gets all of its characters; the high half only
+	// as many as nWidth requires.  If there is no high half, don't split.
+	const int knLowWidth = knDecimalChunkChars << k;
+
+	if( nWidth <= knLowWidth  &&  x < vPowers[k] )
+	{
+		AppendDecimal( x, vPowers, k - 1, nWidth, vcDst );
+		return;
+	}
+
+	CBigNumArenaScope scope;
+	BigNum quotient;
+	BigNum remainder;
+
+	DivideAndModulo( x, vPowers[k], &quotient, &remainder );
+	AppendDecimal( quotient, vPowers, k - 1, ( nWidth > knLowWidth ) ? nWidth - knLowWidth : 0, vcDst );
+	AppendDecimal( remainder, vPowers, k - 1, knLowWidth, vcDst );
+}
+
+
+// The base case: divides x by 10^19 until nothing is left, one digit at a time.
+
+void BigNum::AppendDecimalChunks( const BigNum & x, int nWidth, vector<char> & vcDst )
+{
+	CBigNumArenaScope scope;
+	int nDigits = x.NumDigits();
+	BigNumDigit * pQuotient = scope.Allocate<BigNumDigit>( 2 * nDigits + 1 );
+	BigNumDigit * pChunks = pQuotient + nDigits;		// Least significant first
+	int nChunks = 0;
+	char acChunk[24];
+	int i;
+
+	if( nDigits > 0 )
+	{
+		memcpy( pQuotient, &x.m_v[0], nDigits * sizeof( BigNumDigit ) );
+	}
+
+	while( nDigits > 0 )
+	{
+		BigNumDigit ullRemainder = 0;
+
+		for( i = nDigits - 1; i >= 0; --i )
+		{
+			const BigNumDoubleDigit kullDividend = ( (BigNumDoubleDigit)ullRemainder << knBitsPerDigit ) | pQuotient[i];
+
+			pQuotient[i] = (BigNumDigit)( kullDividend / kullDecimalChunk );
+			ullRemainder = (BigNumDigit)( kullDividend % kullDecimalChunk );
+		}
+
+		while( nDigits > 0  &&  pQuotient[nDigits - 1] == 0 )
+		{
+			--nDigits;
+		}
+
+		pChunks[nChunks++] = ullRemainder;
+	}
+
+	// The most significant chunk has no leading zeros of its own; the others have all 19 characters.
+	const int knTopChars = ( nChunks > 0 ) ? snprintf( acChunk, sizeof( acChunk ), "%llu", pChunks[nChunks - 1] ) : 0;
+	const int knChars = knTopChars + ( ( nChunks > 0 ) ? ( nChunks - 1 ) * knDecimalChunkChars : 0 );
+
+	if( nWidth > knChars )
+	{
+		vcDst.insert( vcDst.end(), nWidth - knChars, '0' );
+	}
+
+	vcDst.insert( vcDst.end(), acChunk, acChunk + knTopChars );
+
+	for( i = nChunks - 2; i >= 0; --i )
+	{
+		snprintf( acChunk, sizeof( acChunk ), "%019llu", pChunks[i] );
+		vcDst.insert( vcDst.end(), acChunk, acChunk + knDecimalChunkChars );
+	}
+}
+
+
+// x = the number whose decimal chunks are pChunks[0 .. nChunks - 1], most
+// significant first; nChunks must be at most 2^( k + 1 ).
+
+void BigNum::SetFromDecimalChunks(
+	BigNum & x, const BigNumDigit * pChunks, int nChunks,
+	const vector<BigNum> & vPowers, int k )
+{
+	int i;
+	int j;
+
+	if( k < 0  ||  nChunks <= knRadixBaseCaseDigits )
+	{
+		// Horner's rule: x = x * 10^19 + chunk.
+		x.SetToZero();
+
+		for( i = 0; i < nChunks; ++i )
+		{
+			BigNumDigit ullCarry = pChunks[i];
+
+			for( j = 0; j < x.NumDigits(); ++j )
+			{
+				const BigNumDoubleDigit kullProduct = (BigNumDoubleDigit)x.m_v[j] * kullDecimalChunk + ullCarry;
+
+				x.m_v[j] = (BigNumDigit)kullProduct;
+				ullCarry = (BigNumDigit)( kullProduct >> knBitsPerDigit );
+			}
+
+			if( ullCarry != 0 )
+			{
+				x.m_v.push_back( ullCarry );
+			}
+		}
+
+		return;
+	}
+
+	// The low half is the last 2^k chunks.
+	const int knLowChunks = 1 << k;
+
+	if( nChunks <= knLowChunks )
+	{
+		SetFromDecimalChunks( x, pChunks, nChunks, vPowers, k - 1 );
+		return;
+	}
+
+	CBigNumArenaScope scope;
+	BigNum high;
+	BigNum low;
+
+	SetFromDecimalChunks( high, pChunks, nChunks - knLowChunks, vPowers, k - 1 );
+	SetFromDecimalChunks( low, pChunks + nChunks - knLowChunks, knLowChunks, vPowers, k - 1 );
+	low.AddProduct( high, vPowers[k] );
+	x = low;
+}
+
+
+void BigNum::ToString( vector<char> & vcDst, int nBase ) const
+{
+	char acDigit[24];
+	int i;
+
+	vcDst.clear();
+
+	if( nBase != 10  &&  nBase != 16 )
+	{
+		ThrowException();
+	}
+
+	if( IsZero() )
+	{
+		vcDst.push_back( '0' );
+	}
+	else if( nBase == 16 )
+	{
+		const int knTopChars = snprintf( acDigit, sizeof( acDigit ), "%llX", m_v.back() );
+
+		vcDst.reserve( knTopChars + ( NumDigits() - 1 ) * 16 + 1 );
+		vcDst.insert( vcDst.end(), acDigit, acDigit + knTopChars );
+
+		for( i = NumDigits() - 2; i >= 0; --i )
+		{
+			snprintf( acDigit, sizeof( acDigit ), "%016llX", m_v[i] );
+			vcDst.insert( vcDst.end(), acDigit, acDigit + 16 );
+		}
+	}
+	else
+	{
+		// The powers up to the largest whose square could still be no more than *this.
+		vector<BigNum> vPowers;
+
+		vPowers.push_back( BigNum( 1 ).MultiplyWithDigit( kullDecimalChunk ) );
+
+		while( 2 * vPowers.back().NumDigits() - 1 <= NumDigits() )
+		{
+			vPowers.push_back( vPowers.back() * vPowers.back() );
+		}
+
+		// Each 64-bit digit takes at most 20 decimal characters.
+		vcDst.reserve( NumDigits() * 20 + 1 );
+		AppendDecimal( *this, vPowers, (int)vPowers.size() - 1, 0, vcDst );
+	}
+
+	vcDst.push_back( '\0' );
+}
+
+
+bool BigNum::FromString( const char * pcSrc, int nBase )
+{
+	const int knChars = strlen( pcSrc );
+	int i;
+
+	SetToZero();
+
+	if( nBase != 10  &&  nBase != 16 )
+	{
+		ThrowException();
+	}
+
+	if( knChars == 0 )
+	{
+		return( false );
+	}
+
+	for( i = 0; i < knChars; ++i )
+	{
+		const char kc = pcSrc[i];
+
+		if( !( kc >= '0'  &&  kc <= '9' )  &&
+			!( nBase == 16  &&  ( ( kc >= 'A'  &&  kc <= 'F' )  ||  ( kc >= 'a'  &&  kc <= 'f' ) ) ) )
+		{
+			return( false );
+		}
+	}
+
+	if( nBase == 16 )
+	{
+		// Sixteen characters to a digit, from the end.
+		m_v.resize( ( knChars + 15 ) / 16 );
+
+		for( i = 0; i < knChars; ++i )
+		{
+			const char kc = pcSrc[knChars - 1 - i];
+			const BigNumDigit kullNibble = ( kc <= '9' ) ? kc - '0' : ( kc & ~0x20 ) - 'A' + 10;
+
+			if( i % 16 == 0 )
+			{
+				m_v[i / 16] = 0;
+			}
+
+			m_v[i / 16] |= kullNibble << ( ( i % 16 ) * 4 );
+		}
+
+		DiscardLeadingZeros();
+		return( true );
+	}
+
+	// Nineteen characters to a chunk, from the end; the first chunk may be short.
+	const int knChunks = ( knChars + knDecimalChunkChars - 1 ) / knDecimalChunkChars;
+	vector<BigNumDigit> vChunks( knChunks, 0 );
+	vector<BigNum> vPowers;
+	int k = 0;
+
+	for( i = 0; i < knChars; ++i )
+	{
+		const int knChunk = knChunks - 1 - ( knChars - 1 - i ) / knDecimalChunkChars;
+
+		vChunks[knChunk] = vChunks[knChunk] * 10 + ( pcSrc[i] - '0' );
+	}
+
+	// The smallest k with knChunks <= 2^( k + 1 ), and the powers up to it.
+	vPowers.push_back( BigNum( 1 ).MultiplyWithDigit( kullDecimalChunk ) );
+
+	while( ( 2 << k ) < knChunks )
+	{
+		vPowers.push_back( vPowers.back() * vPowers.back() );
+		++k;
+	}
+
+	SetFromDecimalChunks( *this, &vChunks[0], knChunks, vPowers, k );
+	DiscardLeadingZeros();
+	return( true );
 }
 
 
@@ -135,19 +452,11 @@ int BigNum::NumSignificantBits( void ) const
 		return( 0 );
 	}
 
-	int nRtn = 16 * m_v.size();
-	const unsigned short kusBack = m_v.back();
-	unsigned short usMask = 32768;
-
-	Assert( kusBack != 0 );
+	const BigNumDigit kullBack = m_v.back();
 
-	while( usMask > 0  &&  ( kusBack & usMask ) == 0 )
-	{
-		--nRtn;
-		usMask >>= 1;
-	}
+	Assert( kullBack != 0 );
 
-	return( nRtn );
+	return( knBitsPerDigit * m_v.size() - __builtin_clzll( kullBack ) );
 }
 
 
@@ -160,31 +469,31 @@ void BigNum::SetBit( int nBit )
 		return;
 	}
 
-	const int knSegment = nBit / 16;
+	const int knDigit = nBit / knBitsPerDigit;
 
-	while( m_v.size() <= knSegment )
+	while( NumDigits() <= knDigit )
 	{
 		m_v.push_back( 0 );
 	}
 
-	m_v[knSegment] |= (unsigned short)( 1 << ( nBit % 16 ) );
+	m_v[knDigit] |= (BigNumDigit)1 << ( nBit % knBitsPerDigit );
 }
 
 
 bool BigNum::TestBit( int nBit ) const
 {
-	const int knSegment = nBit / 16;
+	const int knDigit = nBit / knBitsPerDigit;
 
-	if( nBit < 0  ||  knSegment >= m_v.size() )
+	if( nBit < 0  ||  knDigit >= NumDigits() )
 	{
 		return( false );
 	}
 
-	return( ( m_v[knSegment] & ( 1 << ( nBit % 16 ) ) ) != 0 );
+	return( ( m_v[knDigit] & ( (BigNumDigit)1 << ( nBit % knBitsPerDigit ) ) ) != 0 );
 }
 
 
-// Shift quantity is in UShorts, not bits.
+// Shift quantity is in digits, not bits.
 
 void BigNum::AddShifted( const BigNum & Src, int nLeftShift )
 {
@@ -201,40 +510,40 @@ void BigNum::AddShifted( const BigNum & Src, int nLeftShift )
 		return;
 	}
 
-	while( m_v.size() < nLeftShift )
+	while( NumDigits() < nLeftShift )
 	{
 		m_v.push_back( 0 );
 	}
 
 	int i;
-	unsigned long ulCarry = 0;
+	BigNumDoubleDigit ddCarry = 0;
 	const int knSrcSize = Src.m_v.size();
 
-	for( i = nLeftShift; i - nLeftShift < knSrcSize  ||  ulCarry > 0; ++i )
+	for( i = nLeftShift; i - nLeftShift < knSrcSize  ||  ddCarry > 0; ++i )
 	{
-		const bool kbPastEndOfThis = i >= m_v.size();
+		const bool kbPastEndOfThis = i >= NumDigits();
 
 		if( !kbPastEndOfThis )
 		{
-			ulCarry += (unsigned long)m_v[i];
+			ddCarry += m_v[i];
 		}
 
 		if( i - nLeftShift < knSrcSize )
 		{
-			ulCarry += (unsigned long)Src.m_v[i - nLeftShift];
+			ddCarry += Src.m_v[i - nLeftShift];
 		}
 
-		const unsigned short kusSum = (unsigned short)( ulCarry & 65535 );
+		const BigNumDigit kullSum = (BigNumDigit)ddCarry;
 
-		ulCarry >>= 16;
+		ddCarry >>= knBitsPerDigit;
 
 		if( kbPastEndOfThis )
 		{
-			m_v.push_back( kusSum );
+			m_v.push_back( kullSum );
 		}
 		else
 		{
-			m_v[i] = kusSum;
+			m_v[i] = kullSum;
 		}
 	}
 } // BigNum::AddShifted()
@@ -247,7 +556,7 @@ BigNum & BigNum::operator +=( const BigNum & Src )
 } // BigNum::operator +=()
 
 
-const BigNum BigNum::operator +( const BigNum & Src ) const
+BigNum BigNum::operator +( const BigNum & Src ) const &
 {
 	BigNum sum( *this );
 
@@ -256,6 +565,27 @@ const BigNum BigNum::operator +( const BigNum & Src ) const
 }
 
 
+BigNum BigNum::operator +( const BigNum & Src ) &&
+{
+	*this += Src;
+	return( std::move( *this ) );
+}
+
+
+BigNum BigNum::operator +( BigNum && Src ) const &
+{
+	Src += *this;
+	return( std::move( Src ) );
+}
+
+
+BigNum BigNum::operator +( BigNum && Src ) &&
+{
+	*this += Src;
+	return( std::move( *this ) );
+}
+
+
 BigNum & BigNum::operator -=( const BigNum & Src )
 {
 
@@ -274,23 +604,20 @@ BigNum & BigNum::operator -=( const BigNum & Src )
 #endif
 
 	// Use iterators.
-	unsigned short usBorrow = 0;
+	BigNumDigit ullBorrow = 0;
 	DigitContainerType::iterator iDst;
 	DigitContainerType::const_iterator iSrc = Src.m_v.begin();
 
-	for( iDst = m_v.begin(); iSrc != Src.m_v.end()  ||  usBorrow > 0; ++iDst )
+	for( iDst = m_v.begin(); iSrc != Src.m_v.end()  ||  ullBorrow > 0; ++iDst )
 	{
 		Assert( iDst != m_v.end() );
 
-		unsigned short usOperand2 = usBorrow;
-
-		if( iSrc != Src.m_v.end() )
-		{
-			usOperand2 += *iSrc++;
-		}
+		const BigNumDigit kullOperand2 = ( iSrc != Src.m_v.end() ) ? *iSrc++ : 0;
+		const BigNumDigit kullDiff = *iDst - kullOperand2;
+		const BigNumDigit kullNewBorrow = ( *iDst < kullOperand2  ||  kullDiff < ullBorrow ) ? 1 : 0;
 
-		usBorrow = ( *iDst < usOperand2 ) ? 1 : 0;
-		*iDst -= usOperand2;
+		*iDst = kullDiff - ullBorrow;
+		ullBorrow = kullNewBorrow;
 	}
 
 	DiscardLeadingZeros();
@@ -298,7 +625,7 @@ BigNum & BigNum::operator -=( const BigNum & Src )
 }
 
 
-const BigNum BigNum::operator -( const BigNum & Src ) const
+BigNum BigNum::operator -( const BigNum & Src ) const &
 {
 	BigNum diff( *this );
 
@@ -307,131 +634,350 @@ const BigNum BigNum::operator -( const BigNum & Src ) const
 }
 
 
-const BigNum BigNum::operator *( const BigNum & Src ) const
+BigNum BigNum::operator -( const BigNum & Src ) &&
 {
-	BigNum product;
-	int i;
-	int j;
+	*this -= Src;
+	return( std::move( *this ) );
+}
 
-	for( i = 0; i < m_v.size(); ++i )
-	{
-		const unsigned long kulThisUShort = (unsigned long)m_v[i];
 
-		for( j = 0; j < Src.m_v.size(); ++j )
-		{
-			const unsigned long kulPartialProduct = kulThisUShort * (unsigned long)Src.m_v[j];
-			const BigNum pp( kulPartialProduct );
+BigNum BigNum::operator *( const BigNum & Src ) const
+{
+	BigNum product;
 
-			product.AddShifted( pp, i + j );
-		}
+	if( IsZero()  ||  Src.IsZero() )
+	{
+		return( product );
 	}
 
+	product.m_v.resize( m_v.size() + Src.m_v.size() );
+	DigitsMultiply( &product.m_v[0], &m_v[0], m_v.size(), &Src.m_v[0], Src.m_v.size() );
+	product.DiscardLeadingZeros();
 	return( product );
 }
 
 
+// The product can't be formed in place, so it is formed in a temporary
+// and moved into *this.
+
 BigNum & BigNum::operator *=( const BigNum & Src )
 {
 	return( *this = *this * Src );
 }
 
 
-// Return *this * us.
+// Return *this * ullFactor.
 
-const BigNum BigNum::MultiplyWithUShort( unsigned short us ) const
+BigNum BigNum::MultiplyWithDigit( BigNumDigit ullFactor ) const
 {
-	unsigned long ulCarry = 0;
-	const unsigned long kulFactor = (unsigned long)us;
 	BigNum prod;
-	DigitContainerType::const_iterator i;
 
-	for( i = m_v.begin(); i != m_v.end(); ++i )
+	if( IsZero() )
 	{
-		ulCarry += kulFactor * (unsigned long)*i;
-		prod.m_v.push_back( (unsigned short)( ulCarry & 0xFFFF ) );
-		ulCarry >>= 16;
+		return( prod );
 	}
 
-	prod.m_v.push_back( (unsigned short)( ulCarry & 0xFFFF ) );
+	prod.m_v.resize( m_v.size() + 1 );
+	prod.m_v.back() = DigitsMultiplyAdd( &prod.m_v[0], &m_v[0], m_v.size(), ullFactor );
 	prod.DiscardLeadingZeros();
 	return( prod );
 }
 
 
+BigNum & BigNum::AddProduct( const BigNum & a, const BigNum & b )
+{
+
+	if( a.IsZero()  ||  b.IsZero() )
+	{
+		return( *this );
+	}
+	else if( b.NumDigits() == 1 )
+	{
+		return( AddMultiple( a, b.m_v[0] ) );
+	}
+	else if( a.NumDigits() == 1 )
+	{
+		return( AddMultiple( b, a.m_v[0] ) );
+	}
+
+	const int knProductDigits = a.NumDigits() + b.NumDigits();
+	DigitContainerType vProduct;
+
+	vProduct.resize( knProductDigits );
+	DigitsMultiply( &vProduct[0], &a.m_v[0], a.NumDigits(), &b.m_v[0], b.NumDigits() );
+
+	if( NumDigits() < knProductDigits )
+	{
+		m_v.resize( knProductDigits );
+	}
+
+	m_v.push_back( DigitsAdd( &m_v[0], &m_v[0], m_v.size(), &vProduct[0], knProductDigits ) );
+	DiscardLeadingZeros();
+	return( *this );
+}
+
+
+BigNum & BigNum::SubtractProduct( const BigNum & a, const BigNum & b )
+{
+
+	if( a.IsZero()  ||  b.IsZero() )
+	{
+		return( *this );
+	}
+	else if( b.NumDigits() == 1 )
+	{
+		return( SubtractMultiple( a, b.m_v[0] ) );
+	}
+	else if( a.NumDigits() == 1 )
+	{
+		return( SubtractMultiple( b, a.m_v[0] ) );
+	}
+
+	const int knProductDigits = a.NumDigits() + b.NumDigits();
+	DigitContainerType vProduct;
+
+	vProduct.resize( knProductDigits );
+	DigitsMultiply( &vProduct[0], &a.m_v[0], a.NumDigits(), &b.m_v[0], b.NumDigits() );
+
+	// The product's top digit may be zero.
+	const int knDigits = ( vProduct[knProductDigits - 1] == 0 ) ? knProductDigits - 1 : knProductDigits;
+
+	if( NumDigits() < knDigits  ||
+		DigitsSubtract( &m_v[0], &m_v[0], m_v.size(), &vProduct[0], knDigits ) != 0 )
+	{
+		// The difference is negative.
+		ThrowException();
+	}
+
+	DiscardLeadingZeros();
+	return( *this );
+}
+
+
+BigNum & BigNum::AddMultiple( const BigNum & a, BigNumDigit ullFactor )
+{
+	const int knADigits = a.NumDigits();
+
+	if( knADigits == 0  ||  ullFactor == 0 )
+	{
+		return( *this );
+	}
+
+	if( NumDigits() < knADigits )
+	{
+		m_v.resize( knADigits );
+	}
+
+	// Take the pointers only now, as a may be *this.
+	BigNumDigit ullCarry = DigitsMultiplyAdd( &m_v[0], &a.m_v[0], knADigits, ullFactor );
+
+	if( NumDigits() > knADigits )
+	{
+		ullCarry = DigitsAdd( &m_v[knADigits], &m_v[knADigits], m_v.size() - knADigits, &ullCarry, 1 );
+	}
+
+	if( ullCarry != 0 )
+	{
+		m_v.push_back( ullCarry );
+	}
+
+	return( *this );
+}
+
+
+BigNum & BigNum::SubtractMultiple( const BigNum & a, BigNumDigit ullFactor )
+{
+	const int knADigits = a.NumDigits();
+
+	if( knADigits == 0  ||  ullFactor == 0 )
+	{
+		return( *this );
+	}
+
+	if( NumDigits() < knADigits )
+	{
+		ThrowException();
+	}
+
+	BigNumDigit ullBorrow = DigitsMultiplySubtract( &m_v[0], &a.m_v[0], knADigits, ullFactor );
+
+	if( NumDigits() > knADigits )
+	{
+		ullBorrow = DigitsSubtract( &m_v[knADigits], &m_v[knADigits], m_v.size() - knADigits, &ullBorrow, 1 );
+	}
+
+	if( ullBorrow != 0 )
+	{
+		// The difference is negative.
+		ThrowException();
+	}
+
+	DiscardLeadingZeros();
+	return( *this );
+}
+
+
+// Returns the 64 bits of *this that begin at bit nLowBit.
+
+BigNumDigit BigNum::GetBits( int nLowBit ) const
+{
+	const int knDigit = nLowBit / knBitsPerDigit;
+	const int knShift = nLowBit % knBitsPerDigit;
+	BigNumDigit ullBits = 0;
+
+	if( knDigit < NumDigits() )
+	{
+		ullBits = m_v[knDigit] >> knShift;
+	}
+
+	if( knShift > 0  &&  knDigit + 1 < NumDigits() )
+	{
+		ullBits |= m_v[knDigit + 1] << ( knBitsPerDigit - knShift );
+	}
+
+	return( ullBits );
+}
+
+
+// *this = x * ullX + y * ullY, or x * ullX - y * ullY if bSubtract,
+// in which case the difference must not be negative.
+// The factors must be less than 2^63, and *this must not be x or y.
+
+void BigNum::SetToCombination(
+	const BigNum & x, BigNumDigit ullX,
+	const BigNum & y, BigNumDigit ullY, bool bSubtract )
+{
+	const int knXDigits = x.NumDigits();
+	const int knYDigits = y.NumDigits();
+	const int knDigits = ( knXDigits > knYDigits ? knXDigits : knYDigits ) + 1;
+
+	m_v.assign( knDigits, 0 );
+
+	if( knXDigits > 0 )
+	{
+		m_v[knXDigits] = DigitsMultiplyAdd( &m_v[0], &x.m_v[0], knXDigits, ullX );
+	}
+
+	if( knYDigits > 0 )
+	{
+
+		if( bSubtract )
+		{
+			const BigNumDigit kullBorrow = DigitsMultiplySubtract( &m_v[0], &y.m_v[0], knYDigits, ullY );
+
+			DigitsSubtract( &m_v[knYDigits], &m_v[knYDigits], knDigits - knYDigits, &kullBorrow, 1 );
+		}
+		else
+		{
+			const BigNumDigit kullCarry = DigitsMultiplyAdd( &m_v[0], &y.m_v[0], knYDigits, ullY );
+
+			DigitsAdd( &m_v[knYDigits], &m_v[knYDigits], knDigits - knYDigits, &kullCarry, 1 );
+		}
+	}
+
+	DiscardLeadingZeros();
+}
+
+
 // Return ( *this * b ) % n.
 
-const BigNum BigNum::MultiplyMod( const BigNum & b, const BigNum & n ) const
+BigNum BigNum::MultiplyMod( const BigNum & b, const BigNum & n ) const
 {
 	BigNum c;
-	BigNum d = b;	// A mutable copy of b.
-	DigitContainerType::const_iterator i;
 
-	for( i = m_v.begin(); i != m_v.end(); ++i )
+	if( IsZero()  ||  b.IsZero() )
 	{
-		c += d.MultiplyWithUShort( *i );
-#if 1
-		d <<= 16;
-		d %= n;
-#else
-		d = ( d << 16 ) % n;
-#endif
+		return( c );
 	}
 
+	// Form the full product with the kernel, then reduce it once.
+	c.m_v.resize( m_v.size() + b.m_v.size() );
+	DigitsMultiply( &c.m_v[0], &m_v[0], m_v.size(), &b.m_v[0], b.m_v.size() );
+	c.DiscardLeadingZeros();
 	return( c % n );
 }
 
 
+// Return ( *this * *this ) % n.
+
+BigNum BigNum::SquareMod( const BigNum & n ) const
+{
+	BigNum c;
+
+	if( IsZero() )
+	{
+		return( c );
+	}
+
+	c.m_v.resize( 2 * m_v.size() );
+	DigitsSquare( &c.m_v[0], &m_v[0], m_v.size() );
+	c.DiscardLeadingZeros();
+	return( c % n );
+}
+
+
+// As above, but reducing with a precomputed Barrett reducer.
+
+BigNum BigNum::MultiplyMod( const BigNum & b, const CBarrettReducer & reducer ) const
+{
+	return( reducer.Reduce( *this * b ) );
+}
+
+
+BigNum BigNum::SquareMod( const CBarrettReducer & reducer ) const
+{
+	return( reducer.Reduce( *this * *this ) );
+}
+
+
 // Static function.
 
 void BigNum::DivideAndModulo(
 	const BigNum & dividendParam, const BigNum & divisorParam,
 	BigNum * pQuotient, BigNum * pRemainder )
 {
-	BigNum dividend( dividendParam );
-	BigNum divisor( divisorParam );
+	const int knDividendDigits = dividendParam.NumDigits();
+	const int knDivisorDigits = divisorParam.NumDigits();
 	BigNum quotient;
-	const int knDivisorLeftShift = dividend.NumSignificantBits() - divisor.NumSignificantBits();
-	int i;
+	BigNum remainder;
 
-	if( knDivisorLeftShift > 0 )
+	if( divisorParam.IsZero() )
 	{
-		divisor <<= knDivisorLeftShift;
+		ThrowException();
 	}
 
-	for( i = knDivisorLeftShift; i >= 0; --i )
+	if( dividendParam < divisorParam )
 	{
-		
-		if( dividend >= divisor )
-		{
-			dividend -= divisor;
-			Assert( dividend < divisor );
-
-			if( pQuotient != 0 )
-			{
-				quotient.SetBit( i );
-			}
-		}
-
-#if 1
-		divisor.ShiftRightBy1();
-#else
-		divisor >>= 1;
-#endif
+		remainder = dividendParam;
+	}
+	else
+	{
+		// Word-at-a-time long division.  The results are built in
+		// locals, since either output may alias an input.
+		quotient.m_v.resize( knDividendDigits - knDivisorDigits + 1 );
+		remainder.m_v.resize( knDivisorDigits );
+		DigitsDivide(
+			( pQuotient != 0 ) ? &quotient.m_v[0] : 0,
+			( pRemainder != 0 ) ? &remainder.m_v[0] : 0,
+			&dividendParam.m_v[0], knDividendDigits,
+			&divisorParam.m_v[0], knDivisorDigits );
+		quotient.DiscardLeadingZeros();
+		remainder.DiscardLeadingZeros();
 	}
 
 	if( pQuotient != 0 )
 	{
-		*pQuotient = quotient;
+		*pQuotient = std::move( quotient );
 	}
 
 	if( pRemainder != 0 )
 	{
-		*pRemainder = dividend;
+		*pRemainder = std::move( remainder );
 	}
 }
 
 
-const BigNum BigNum::operator /( const BigNum & Src ) const
+BigNum BigNum::operator /( const BigNum & Src ) const
 {
 	BigNum quotient;
 
@@ -440,24 +986,80 @@ const BigNum BigNum::operator /( const BigNum & Src ) const
 }
 
 
-BigNum & BigNum::operator /=( const BigNum & Src )
-{
-	return( *this = *this / Src );
+// The kernel may write the quotient over the dividend.
+
+BigNum & BigNum::operator /=( const BigNum & Src )
+{
+	const int knDigits = NumDigits();
+	const int knSrcDigits = Src.NumDigits();
+
+	if( knSrcDigits == 0 )
+	{
+		ThrowException();
+	}
+	else if( this == &Src )
+	{
+		return( *this = BigNum( 1 ) );
+	}
+	else if( *this < Src )
+	{
+		SetToZero();
+		return( *this );
+	}
+
+	DigitsDivide( &m_v[0], 0, &m_v[0], knDigits, &Src.m_v[0], knSrcDigits );
+	m_v.resize( knDigits - knSrcDigits + 1 );
+	DiscardLeadingZeros();
+	return( *this );
+}
+
+
+BigNum BigNum::operator %( const BigNum & Src ) const
+{
+	BigNum remainder;
+
+	DivideAndModulo( *this, Src, 0, &remainder );
+	return( remainder );
+}
+
+
+// The kernel may write the remainder over the dividend.
+
+BigNum & BigNum::operator %=( const BigNum & Src )
+{
+	const int knDigits = NumDigits();
+	const int knSrcDigits = Src.NumDigits();
+
+	if( knSrcDigits == 0 )
+	{
+		ThrowException();
+	}
+	else if( this == &Src )
+	{
+		SetToZero();
+		return( *this );
+	}
+	else if( *this < Src )
+	{
+		return( *this );
+	}
+
+	DigitsDivide( 0, &m_v[0], &m_v[0], knDigits, &Src.m_v[0], knSrcDigits );
+	m_v.resize( knSrcDigits );
+	DiscardLeadingZeros();
+	return( *this );
 }
 
 
-const BigNum BigNum::operator %( const BigNum & Src ) const
+BigNum BigNum::operator %( const CBarrettReducer & reducer ) const
 {
-	BigNum remainder;
-
-	DivideAndModulo( *this, Src, 0, &remainder );
-	return( remainder );
+	return( reducer.Reduce( *this ) );
 }
 
 
-BigNum & BigNum::operator %=( const BigNum & Src )
+BigNum & BigNum::operator %=( const CBarrettReducer & reducer )
 {
-	return( *this = *this % Src );
+	return( *this = reducer.Reduce( *this ) );
 }
 
 
@@ -473,10 +1075,10 @@ BigNum & BigNum::operator >>=( int nShift )
 		return( *this <<= -nShift );
 	}
 
-	const int knMajorShift = nShift / 16;
-	const int knMinorShift = nShift % 16;
+	const int knMajorShift = nShift / knBitsPerDigit;
+	const int knMinorShift = nShift % knBitsPerDigit;
 
-	if( knMajorShift >= m_v.size() )
+	if( knMajorShift >= NumDigits() )
 	{
 		SetToZero();
 		return( *this );
@@ -487,14 +1089,14 @@ BigNum & BigNum::operator >>=( int nShift )
 		// If this was a deque, we could just pop_front() knMajorShift times.
 		int i;
 
-		for( i = 0; i + knMajorShift < m_v.size(); ++i )
+		for( i = 0; i + knMajorShift < NumDigits(); ++i )
 		{
 			m_v[i] = m_v[i + knMajorShift];
 		}
 
 		// These leading zeros will be discarded below.
 
-		for( ; i < m_v.size(); ++i )
+		for( ; i < NumDigits(); ++i )
 		{
 			m_v[i] = 0;
 		}
@@ -503,16 +1105,16 @@ BigNum & BigNum::operator >>=( int nShift )
 	{
 		int i;
 
-		for( i = 0; i + knMajorShift + 1 < m_v.size(); ++i )
+		for( i = 0; i + knMajorShift + 1 < NumDigits(); ++i )
 		{
-			m_v[i] = (unsigned short)( ( m_v[i + knMajorShift] >> knMinorShift ) | ( m_v[i + knMajorShift + 1] << ( 16 - knMinorShift ) ) );
+			m_v[i] = ( m_v[i + knMajorShift] >> knMinorShift ) | ( m_v[i + knMajorShift + 1] << ( knBitsPerDigit - knMinorShift ) );
 		}
 
-		m_v[i] = (unsigned short)( m_v[i + knMajorShift] >> knMinorShift );
+		m_v[i] = m_v[i + knMajorShift] >> knMinorShift;
 
 		// These leading zeros will be discarded below.
 
-		for( ++i; i < m_v.size(); ++i )
+		for( ++i; i < NumDigits(); ++i )
 		{
 			m_v[i] = 0;
 		}
@@ -537,7 +1139,7 @@ BigNum & BigNum::ShiftRightBy1( void )
 
 	while( ++iNext != m_v.end() )
 	{
-		*iCurrent = ( *iCurrent >> 1 ) | ( *iNext << 15 );
+		*iCurrent = ( *iCurrent >> 1 ) | ( *iNext << ( knBitsPerDigit - 1 ) );
 		iCurrent = iNext;
 	}
 
@@ -548,12 +1150,13 @@ BigNum & BigNum::ShiftRightBy1( void )
 #endif
 
 
-// TODO: Rewrite <<= in terms of <<.
+// The digits are shifted in place, from the top down,
+// so that each one is read before it is overwritten.
 
 BigNum & BigNum::operator <<=( int nShift )
 {
 
-	if( nShift == 0 )
+	if( nShift == 0  ||  IsZero() )
 	{
 		return( *this );
 	}
@@ -562,42 +1165,38 @@ BigNum & BigNum::operator <<=( int nShift )
 		return( *this >>= -nShift );
 	}
 
-	const int knMajorShift = nShift / 16;
-	const int knMinorShift = nShift % 16;
+	const int knMajorShift = nShift / knBitsPerDigit;
+	const int knMinorShift = nShift % knBitsPerDigit;
+	const int knDigits = m_v.size();
 	int i;
-	BigNum result;
 
-	for( i = 0; i < knMajorShift; ++i )
-	{
-		result.m_v.push_back( 0 );
-	}
+	m_v.resize( knDigits + knMajorShift + 1 );
 
 	if( knMinorShift == 0 )
 	{
-		// If this was a deque, we could just push_front( 0 ) knMajorShift times.
 
-		for( i = 0; i < m_v.size(); ++i )
+		for( i = knDigits - 1; i >= 0; --i )
 		{
-			result.m_v.push_back( m_v[i] );
+			m_v[i + knMajorShift] = m_v[i];
 		}
 	}
 	else
 	{
-		unsigned short usPrev = 0;
+		m_v[knDigits + knMajorShift] = m_v[knDigits - 1] >> ( knBitsPerDigit - knMinorShift );
 
-		for( i = 0; i < m_v.size(); ++i )
+		for( i = knDigits - 1; i > 0; --i )
 		{
-			const unsigned short kusNext = m_v[i];
-			const unsigned short kusNew = (unsigned short)( ( usPrev >> ( 16 - knMinorShift ) ) | ( kusNext << knMinorShift ) );
-
-			result.m_v.push_back( kusNew );
-			usPrev = kusNext;
+			m_v[i + knMajorShift] = ( m_v[i] << knMinorShift ) | ( m_v[i - 1] >> ( knBitsPerDigit - knMinorShift ) );
 		}
 
-		result.m_v.push_back( (unsigned short)( usPrev >> ( 16 - knMinorShift ) ) );
+		m_v[knMajorShift] = m_v[0] << knMinorShift;
+	}
+
+	for( i = 0; i < knMajorShift; ++i )
+	{
+		m_v[i] = 0;
 	}
 
-	*this = result;
 	DiscardLeadingZeros();
 	return( *this );
 }
@@ -680,9 +1279,10 @@ void BigNum::ReadFromFile( FILE * srcFile )
 	ByteSwapUnsignedShort( usReadSize );
 #endif
 
-	m_v.clear();
+	vector<unsigned short> vSegments( usReadSize );
+	int i;
 
-	while( usReadSize-- > 0 )
+	for( i = 0; i < usReadSize; ++i )
 	{
 		unsigned short usData = 0;
 
@@ -698,16 +1298,17 @@ void BigNum::ReadFromFile( FILE * srcFile )
 		ByteSwapUnsignedShort( usData );
 #endif
 
-		m_v.push_back( usData );
+		vSegments[i] = usData;
 	}
 
-	DiscardLeadingZeros();
+	SetFromSegments( usReadSize, usReadSize > 0 ? &vSegments[0] : 0 );
 }
 
 
 void BigNum::WriteToFile( FILE * dstFile ) const
 {
-	unsigned short usWriteSize = (unsigned short)m_v.size();
+	const int knNumSegments = NumSegments();
+	unsigned short usWriteSize = (unsigned short)knNumSegments;
 
 #ifdef BIG_ENDIAN
 	ByteSwapUnsignedShort( usWriteSize );
@@ -723,9 +1324,9 @@ void BigNum::WriteToFile( FILE * dstFile ) const
 
 	int i;
 
-	for( i = 0; i < m_v.size(); ++i )
+	for( i = 0; i < knNumSegments; ++i )
 	{
-		unsigned short usData = m_v[i];
+		unsigned short usData = GetSegment( i );
 
 #ifdef BIG_ENDIAN
 		ByteSwapUnsignedShort( usData );
@@ -742,173 +1343,69 @@ void BigNum::WriteToFile( FILE * dstFile ) const
 }
 
 
-unsigned short BigNum::ReadFromFile( FILE * srcFile, unsigned char * pucSrcBuf, int nReadSize )
-{
-	bool bDataIsEncrypted = false;
-	unsigned short usBytesEncrypted = 0;
-
-	if( nReadSize <= 0 )
-	{
-		// We're reading encrypted data.
-		// The first UShort is the number of bytes of raw, unencrypted data represented in this BigNum.
-		// The second UShort is the number of segments (UShorts) in this BigNum.
-		unsigned short usReadSize = 0;
-		unsigned char acHeaderBuf[4];
-		const size_t unNumItemsRead = fread( acHeaderBuf, sizeof( unsigned char ), 4, srcFile );
-
-		if( unNumItemsRead == 0  &&  feof( srcFile ) )
-		{
-			// End of source file.
-			return( 0 );
-		}
-		else if( unNumItemsRead != 4 )
-		{
-			Signal();
-			ThrowException(  );
-		}
-
-		usBytesEncrypted = *(unsigned short *)acHeaderBuf;
-		usReadSize = *(unsigned short *)( acHeaderBuf + 2 );
-
-#ifdef BIG_ENDIAN
-		ByteSwapUnsignedShort( usBytesEncrypted );
-		ByteSwapUnsignedShort( usReadSize );
-#endif
-
-		nReadSize = (int)usReadSize;
-		bDataIsEncrypted = true;
-	}
-
-	size_t unNumBytesRead = fread( pucSrcBuf, sizeof( unsigned char ), sizeof( unsigned short ) * (size_t)nReadSize, srcFile );
-
-	if( !bDataIsEncrypted )
-	{
-
-		if( unNumBytesRead == 0  &&  feof( srcFile ) )
-		{
-			// End of source file.
-			return( 0 );
-		}
-
-		usBytesEncrypted = (unsigned short)unNumBytesRead;
-	}
-
-	m_v.clear();
-
-	// This loop may write a partial UShort at the end;
-	// clear the SrcBuf beforehand.
-
-	for( ; unNumBytesRead > 0; unNumBytesRead -= sizeof( unsigned short ) )
-	{
-		unsigned short usData = *(unsigned short *)pucSrcBuf;
-
-#ifdef BIG_ENDIAN
-		if( bDataIsEncrypted )
-		{
-			ByteSwapUnsignedShort( usData );
-		}
-#endif
-
-		m_v.push_back( usData );
-		pucSrcBuf += 2;
-	}
-
-	DiscardLeadingZeros();
-	return( usBytesEncrypted );
-}
-
-
-void BigNum::WriteToFile(
-	FILE * dstFile, unsigned char * pucBuf,
-	unsigned short usBytesEncrypted, size_t unBytesToWrite ) const
+void BigNum::SetToRandom( int nBitLength )
 {
-	int nBufSizeInUShorts = 0;
-	unsigned short * pusBuf = (unsigned short *)pucBuf;
-
-	if( usBytesEncrypted > 0 )
-	{
-		// We're writing encrypted data.
-		// The first UShort is the number of bytes of raw, unencrypted data represented in this BigNum.
-		// The second UShort is the number of segments (UShorts) in this BigNum.
-		pusBuf[0] = usBytesEncrypted;
-		pusBuf[1] = (unsigned short)NumSegments();
-		nBufSizeInUShorts = 2;
-	}
-
+	// Draw 16 bits per call to rand(), as earlier versions did.
+	const int knNumUShorts = ( nBitLength + 15 ) / 16;
 	int i;
 
-	for( i = 0; i < m_v.size(); ++i )
-	{
-		pusBuf[nBufSizeInUShorts + i] = m_v[i];
-
-#if 0
-		// Do byte-swapping here on the Mac.
-		ByteSwapUShort( ... );
-#endif
-	}
+	m_v.clear();
 
-	nBufSizeInUShorts += m_v.size();
-	
-	if( unBytesToWrite == 0 )
+	for( i = 0; i < knNumUShorts; ++i )
 	{
-		unBytesToWrite = nBufSizeInUShorts * sizeof( unsigned short );
+		const int knShift = ( i % knSegmentsPerDigit ) * knBitsPerSegment;
 
-#ifdef BIG_ENDIAN
-		for( i = 0; i < nBufSizeInUShorts; ++i )
+		if( knShift == 0 )
 		{
-			ByteSwapUnsignedShort( pusBuf[i] );
+			m_v.push_back( 0 );
 		}
-#endif
-	}
-
-	const size_t unNumBytesWritten = fwrite( pusBuf, 1, unBytesToWrite, dstFile );
-
-	if( unNumBytesWritten != unBytesToWrite )
-	{
-		Signal();
-		ThrowException(  );
-	}
-}
-
-
-void BigNum::SetToRandom( int nBitLength )
-{
-	int nNumUShorts = ( nBitLength + 15 ) / 16;
-
-	m_v.clear();
 
-	while( nNumUShorts-- > 0 )
-	{
-		m_v.push_back( (unsigned short)( rand() & 65535 ) );
+		m_v.back() |= (BigNumDigit)( rand() & 65535 ) << knShift;
 	}
 
-	const unsigned short kusMSBMask = (unsigned short)( 1 << ( ( nBitLength + 15 ) & 15 ) );
+	// Clear the bits above the most significant bit, and set the MSB.
+	const int knMSBDigit = ( nBitLength - 1 ) / knBitsPerDigit;
+	const BigNumDigit kullMSBMask = (BigNumDigit)1 << ( ( nBitLength - 1 ) % knBitsPerDigit );
 
-	m_v.back() &= (unsigned short)( kusMSBMask - 1 );
-	m_v.back() |= kusMSBMask;
+	m_v.resize( knMSBDigit + 1 );
+	m_v.back() &= kullMSBMask - 1;
+	m_v.back() |= kullMSBMask;
 }
 
 
 // From "Introduction to Algorithms", p. 840.
+// d, one and nMinus1 are all in Montgomery form, which preserves equality.
+// They are kept as raw digits, so the loop neither allocates nor normalizes,
+// and each step is one of the context's products (a fixed-width one,
+// for the standard prime sizes).
 
-bool MillerRabinWitness( const BigNum & a, const BigNum & n )
+bool MillerRabinWitness( const BigNum & a, const CMontgomeryContext & mont )
 {
+	const BigNum nMinus1 = mont.GetModulus() - BigNum( 1 );
+	const int knDigits = mont.GetNumDigits();
+	const BigNumDigit * kpOne = mont.GetOneDigits();
+	CBigNumArenaScope scope;
+	BigNumDigit * pNMinus1 = scope.Allocate<BigNumDigit>( 4 * knDigits + mont.GetWorkSize() );
+	BigNumDigit * pA = pNMinus1 + knDigits;
+	BigNumDigit * pD = pA + knDigits;
+	BigNumDigit * pX = pD + knDigits;
+	BigNumDigit * pWork = pX + knDigits;
 	int i;
-	BigNum d( 1 );
-	const BigNum one( 1 );
-	const BigNum nMinus1 = n - one;
+
+	mont.LoadDigits( pNMinus1, nMinus1 );
+	mont.ToMontgomeryDigits( pNMinus1, pNMinus1, pWork );
+	mont.LoadDigits( pA, a );
+	mont.ToMontgomeryDigits( pA, pA, pWork );
+	memcpy( pD, kpOne, knDigits * sizeof( BigNumDigit ) );
 
 	for( i = nMinus1.NumSignificantBits() - 1; i >= 0; --i )
 	{
-		const BigNum x = d;
-
-#if 1
-		d = d.MultiplyMod( d, n );
-#else
-		d = ( d * d ) % n;
-#endif
+		memcpy( pX, pD, knDigits * sizeof( BigNumDigit ) );
+		mont.MultiplyDigits( pD, pD, pD, pWork );
 
-		if( d == one  &&  x != one  &&  x != nMinus1 )
+		if( DigitsCompare( pD, kpOne, knDigits ) == 0  &&
+			DigitsCompare( pX, kpOne, knDigits ) != 0  &&
+			DigitsCompare( pX, pNMinus1, knDigits ) != 0 )
 		{
 			// x is a non-trivial square root of 1 (mod n).
 			return( true );
@@ -916,22 +1413,20 @@ bool MillerRabinWitness( const BigNum & a, const BigNum & n )
 
 		if( nMinus1.TestBit( i ) )
 		{
-#if 1
-			d = d.MultiplyMod( a, n );
-#else
-			d = ( d * a ) % n;
-#endif
+			mont.MultiplyDigits( pD, pD, pA, pWork );
 		}
 	}
 
-	return( d != one );
+	return( DigitsCompare( pD, kpOne, knDigits ) != 0 );
 }
 
 
 // From "Introduction to Algorithms", p. 841.
+// n must be odd.
 
 bool MillerRabinIsComposite( const BigNum & n, int s )
 {
+	const CMontgomeryContext kMont( n );
 	int i;
 
 	printf( "Witness # " );
@@ -948,7 +1443,7 @@ bool MillerRabinIsComposite( const BigNum & n, int s )
 
 		printf( "%d ", i );
 
-		if( MillerRabinWitness( a, n ) )
+		if( MillerRabinWitness( a, kMont ) )
 		{
 			printf( "Composite.\n" );
 			return( true );
@@ -970,8 +1465,10 @@ void BigNum::SetToRandomPrime( int nPrimeBitLength, int nWhichPrime )
 	{
 		SetToRandom( nPrimeBitLength );
 
-		// Make the number odd.
+		// Make the number odd, and set the bit below the MSB, so that the product
+		// of two such primes has exactly twice as many bits.
 		m_v.front() |= 1;
+		SetBit( nPrimeBitLength - 2 );
 
 		if( nWhichPrime > 0 )
 		{
@@ -988,15 +1485,29 @@ void BigNum::SetToRandomPrime( int nPrimeBitLength, int nWhichPrime )
 
 // Compute ( a ^ b ) mod c.
 
-const BigNum ExponentMod( const BigNum & a, const BigNum & b, const BigNum & c )
+BigNum ExponentMod( const BigNum & a, const BigNum & b, const BigNum & c )
 {
+
+	if( !c.IsZero()  &&  c.TestBit( 0 ) )
+	{
+		// Odd moduli (all RSA moduli among them) need no division per step.
+		return( CMontgomeryContext( c ).ExponentMod( a, b ) );
+	}
+
+	// Even moduli: reduce each product with a Barrett reducer built once.
+	const CBarrettReducer kReducer( c );
+	const BigNum kReducedA = a % kReducer;
 	int i;
 	BigNum result( 1 );
 
+	// Each step's temporaries are released with its scope.
+
 	for( i = b.NumSignificantBits() - 1; i >= 0; --i )
 	{
+		CBigNumArenaScope scope;
+
 #if 1
-		result = result.MultiplyMod( result, c );
+		result = result.SquareMod( kReducer );
 #else
 		result = ( result * result ) % c;
 #endif
@@ -1004,7 +1515,7 @@ const BigNum ExponentMod( const BigNum & a, const BigNum & b, const BigNum & c )
 		if( b.TestBit( i ) )
 		{
 #if 1
-			result = result.MultiplyMod( a, c );
+			result = result.MultiplyMod( kReducedA, kReducer );
 #else
 			result = ( result * a ) % c;
 #endif
@@ -1015,95 +1526,231 @@ const BigNum ExponentMod( const BigNum & a, const BigNum & b, const BigNum & c )
 }
 
 
-// From "Introduction to Algorithms", p. 812.
-// Given a and b, finds d, x, and y such that:
-// 1) d = gcd( a, b ), and
-// 2) d = a * x + b * y.
+// ExtendedGCD() works on the leading knLehmerBits bits of its operands.
+// Keeping them below 2^61 keeps every single-precision intermediate,
+// including the cofactors, well inside a signed 64-bit integer.
 
-// The algorithm has been modified so that d == a * x - b * y,
+static const int knLehmerBits = 61;
 
-void ExtendedEuclid(
-	const BigNum & a, const BigNum & b,
-	BigNum & d, BigNum & x, BigNum & y )
+
+// Lehmer's extended Euclidean algorithm ("The Art of Computer Programming",
+// Volume 2, Section 4.5.2, Algorithm L).  Most Euclidean steps are simulated
+// on the leading bits of u and v alone; each run of such steps is then
+// applied to the full numbers as one 2 x 2 matrix, with multiplications
+// by single digits.  Only when the leading bits can't determine a quotient
+// is a full-precision division done.
+// The cofactors of a alternate in sign, and those of b have the opposite signs,
+// so only their magnitudes are kept, along with the sign of s0.
+// The same matrices apply to both pairs of cofactors.
+
+void BigNum::ExtendedGCD( const BigNum & a, const BigNum & b, BigNum & d, BigNum * pX, BigNum * pY )
 {
-	
-	if( b.IsZero() )
-	{
-		d = a;
-		x = BigNum( 1 );
-		y = BigNum( 0 );
+	// The working numbers reuse their storage from step to step,
+	// so they only take from the arena as they grow.
+	CBigNumArenaScope scope;
+	const bool kbCofactors = ( pX != 0  ||  pY != 0 );
+	BigNum u( a );
+	BigNum v( b );
+	BigNum s0( 1 );			// u == a * s0 + b * t0
+	BigNum s1;				// v == a * s1 + b * t1
+	BigNum t0;
+	BigNum t1( 1 );
+	bool bS0Negative = false;
+	BigNum temp1;
+	BigNum temp2;
+
+	while( !v.IsZero() )
+	{
+		long long llA = 1;
+		long long llB = 0;
+		long long llC = 0;
+		long long llD = 1;
+		int nSteps = 0;
+
+		if( v <= u )
+		{
+			// The leading bits of u, and the bits of v in the same positions.
+			const int knShift = u.NumSignificantBits() > knLehmerBits ? u.NumSignificantBits() - knLehmerBits : 0;
+			long long llU = (long long)u.GetBits( knShift );
+			long long llV = (long long)v.GetBits( knShift );
+
+			for( ;; )
+			{
+
+				if( llV + llC == 0  ||  llV + llD == 0 )
+				{
+					break;
+				}
+
+				const long long kllQ = ( llU + llA ) / ( llV + llC );
+
+				if( kllQ != ( llU + llB ) / ( llV + llD ) )
+				{
+					break;
+				}
+
+				long long llT = llA - kllQ * llC;
+
+				llA = llC;
+				llC = llT;
+				llT = llB - kllQ * llD;
+				llB = llD;
+				llD = llT;
+				llT = llU - kllQ * llV;
+				llU = llV;
+				llV = llT;
+				++nSteps;
+			}
+		}
+
+		if( llB == 0 )
+		{
+			// Take one full-precision step.  Its temporaries are released with its own scope.
+			CBigNumArenaScope stepScope;
+			BigNum q;
+
+			DivideAndModulo( u, v, &q, &temp1 );
+			u.m_v.swap( v.m_v );
+			v.m_v.swap( temp1.m_v );
+
+			if( kbCofactors )
+			{
+				s0.AddProduct( q, s1 );
+				s0.m_v.swap( s1.m_v );
+				bS0Negative = !bS0Negative;
+			}
+
+			if( pY != 0 )
+			{
+				t0.AddProduct( q, t1 );
+				t0.m_v.swap( t1.m_v );
+			}
+
+			continue;
+		}
+
+		// After nSteps steps, A and D have the sign ( -1 )^nSteps,
+		// and B and C have the opposite sign.
+		const bool kbEven = ( nSteps % 2 ) == 0;
+		const BigNumDigit kullA = llA < 0 ? -llA : llA;
+		const BigNumDigit kullB = llB < 0 ? -llB : llB;
+		const BigNumDigit kullC = llC < 0 ? -llC : llC;
+		const BigNumDigit kullD = llD < 0 ? -llD : llD;
+
+		// u = A * u + B * v and v = C * u + D * v; both are non-negative.
+
+		if( kbEven )
+		{
+			temp1.SetToCombination( u, kullA, v, kullB, true );
+			temp2.SetToCombination( v, kullD, u, kullC, true );
+		}
+		else
+		{
+			temp1.SetToCombination( v, kullB, u, kullA, true );
+			temp2.SetToCombination( u, kullC, v, kullD, true );
+		}
+
+		u.m_v.swap( temp1.m_v );
+		v.m_v.swap( temp2.m_v );
+
+		if( kbCofactors )
+		{
+			// The two terms of each new cofactor have the same sign.
+			temp1.SetToCombination( s0, kullA, s1, kullB, false );
+			temp2.SetToCombination( s0, kullC, s1, kullD, false );
+			s0.m_v.swap( temp1.m_v );
+			s1.m_v.swap( temp2.m_v );
+			bS0Negative = bS0Negative != !kbEven;
+		}
+
+		if( pY != 0 )
+		{
+			temp1.SetToCombination( t0, kullA, t1, kullB, false );
+			temp2.SetToCombination( t0, kullC, t1, kullD, false );
+			t0.m_v.swap( temp1.m_v );
+			t1.m_v.swap( temp2.m_v );
+		}
 	}
-	else
+
+	// d == a * |s0| - b * |t0|, or b * |t0| - a * |s0|.  In the second case,
+	// adding a * b / d to both terms gives d == a * ( b / d - |s0| ) - b * ( a / d - |t0| ).
+
+	if( pX != 0 )
 	{
-		BigNum ADivB;
-		BigNum AModB;
-		BigNum x2;
-		BigNum y2;
-
-		BigNum::DivideAndModulo( a, b, &ADivB, &AModB );
-		ExtendedEuclid( b, AModB, d, x2, y2 );
-#if 0
-		printf( "d, a, b, ADivB, AModB, x2, y2:\n" );
-		d.PrintHex();
-		a.PrintHex();
-		b.PrintHex();
-		ADivB.PrintHex();
-		AModB.PrintHex();
-		x2.PrintHex();
-		y2.PrintHex();
-#endif
-#if 1
-		// Modify the algorithm so that d == a * x - b * y,
-		// with x >= 0 and y >= 0.
-		Assert( d == b * x2 - AModB * y2 );
-		const BigNum temp1 = x2 + ADivB * y2;
-		BigNum n = y2 / b + 1;
-		const BigNum n2 = temp1 / a + 1;
-
-		if( n2 > n )
+
+		if( bS0Negative )
+		{
+			*pX = b / u - s0;
+		}
+		else
 		{
-			n = n2;
+			*pX = s0;
 		}
+	}
 
-		x = n * b - y2;
-		y = n * a - temp1;
-		Assert( d == a * x - b * y );
-#else
-		x = y2;
-		y = x2 - ADivB * y2;
-		Assert( d == a * x + b * y );
-#endif
+	if( pY != 0 )
+	{
+
+		if( bS0Negative  &&  !a.IsZero() )
+		{
+			*pY = a / u - t0;
+		}
+		else if( bS0Negative )
+		{
+			// 0 * x - b * y == b has no solution with y >= 0.
+			*pY = BigNum( 0 );
+		}
+		else
+		{
+			*pY = t0;
+		}
 	}
+
+	d = u;
+}
+
+
+// Given a and b, finds d, x, and y such that:
+// 1) d = gcd( a, b ), and
+// 2) d = a * x - b * y, with x >= 0 and y >= 0.
+// (Cf. "Introduction to Algorithms", p. 812, which has d = a * x + b * y.)
+
+void ExtendedEuclid(
+	const BigNum & a, const BigNum & b,
+	BigNum & d, BigNum & x, BigNum & y )
+{
+	BigNum::ExtendedGCD( a, b, d, &x, &y );
 }
 
 
-const BigNum GCD( const BigNum & a, const BigNum & b )
+BigNum GCD( const BigNum & a, const BigNum & b )
 {
 	BigNum d;
-	BigNum x;
-	BigNum y;
 
-	ExtendedEuclid( a, b, d, x, y );
+	BigNum::ExtendedGCD( a, b, d, 0, 0 );
 	return( d );
 }
 
 
 // If possible, find x such that a * x == 1 (mod n).
+// Lehmer's algorithm is the fast path for every modulus, odd or not: a binary
+// inverse, a pass over the digits for every bit or two, is several times slower
+// at key sizes.
 
 bool MultiplicativeInverse( const BigNum & a, const BigNum & n, BigNum & x )
 {
 	BigNum d;
-	BigNum k;
 
-	ExtendedEuclid( a, n, d, x, k );
-	
-	if( d != BigNum( 1 ) )
+	BigNum::ExtendedGCD( a, n, d, &x, 0 );
+
+	// ExtendedGCD()'s x is in ( 0, n ]; modulo 1, the only residue is 0.
+
+	if( n == BigNum( 1 ) )
 	{
-		return( false );
+		x = BigNum( 0 );
 	}
 
-	x %= n;
-	return( true );
+	return( d == BigNum( 1 ) );
 }
 
 
@@ -1111,23 +1758,67 @@ bool MultiplicativeInverse( const BigNum & a, const BigNum & n, BigNum & x )
 // The public key is ( e, n ).
 // The private key is ( d, n ).
 
-void GenerateRSAKeys( int nBitLength, BigNum & d, BigNum & e, BigNum & n )
+void GenerateRSAKeys(
+	int nBitLength, int nNumPrimes, BigNum & d, BigNum & e, BigNum & n,
+	vector<BigNum> & vPrimes, bool bUseExponent65537 )
 {
-	BigNum p;
-	BigNum q;
-	const int knPrimeBitLength = nBitLength / 2 + 1;
+	const BigNum kExponent65537( 65537 );
+	BigNum phiN;
+	int i;
+	int j;
 
-	// 1) Choose p and q.
+	// 1) Choose the distinct primes p, q, ...
+	// More primes are smaller primes, which are much quicker to find.
+	// Their lengths add up to nBitLength, and each has its top two bits set,
+	// so two of them always make an n of exactly nBitLength bits (each is at least
+	// 3/4 of 2^length, and ( 3/4 )^2 > 1/2); with more, the primes are chosen
+	// again until they do.
 	srand( time( 0 ) );
-	p.SetToRandomPrime( knPrimeBitLength, 1 );
-	q.SetToRandomPrime( knPrimeBitLength, 2 );
+	vPrimes.resize( nNumPrimes );
+
+	do
+	{
+		n = BigNum( 1 );
+		phiN = BigNum( 1 );
+
+		for( i = 0; i < nNumPrimes; ++i )
+		{
+			const int knPrimeBitLength = nBitLength / nNumPrimes + ( ( i < nBitLength % nNumPrimes ) ? 1 : 0 );
+
+			do
+			{
+				vPrimes[i].SetToRandomPrime( knPrimeBitLength, i + 1 );
+
+				for( j = 0; j < i  &&  vPrimes[j] != vPrimes[i]; ++j )
+				{
+				}
+			}
+			// 65537 is prime, so it is prime to phi( n ) unless it divides some p - 1.
+			while( j < i  ||
+				( bUseExponent65537  &&  ( ( vPrimes[i] - BigNum( 1 ) ) % kExponent65537 ).IsZero() ) );
+
+			// 2) Compute n, and phi( n ).
+			n *= vPrimes[i];
+			phiN *= vPrimes[i] - BigNum( 1 );
+		}
+	}
+	while( n.NumSignificantBits() != nBitLength );
 
-	// 2) Compute n.
-	n = p * q;
 	printf( "Found n.\n" );
 
 	// 3 and 4) Find e and d.
-	const BigNum phiN = ( p - BigNum( 1 ) ) * ( q - BigNum( 1 ) );
+
+	if( bUseExponent65537 )
+	{
+		e = kExponent65537;
+
+		if( !MultiplicativeInverse( e, phiN, d ) )
+		{
+			ThrowHelixException( "65537 has no inverse modulo phi( n )." );
+		}
+
+		return;
+	}
 
 	// Seed the random number generator with the current time.
 	srand( time( 0 ) );
@@ -1146,63 +1837,97 @@ void GenerateRSAKeys( int nBitLength, BigNum & d, BigNum & e, BigNum & n )
 
 
 void CHelixApp::EncryptFile(
-	FILE * srcFile, FILE * dstFile,
-	const BigNum & exponent, const BigNum & n ) const
+	FILE * srcFile, FILE * dstFile, const CHelixRSAKey & key ) const
 {
+	const BigNum & n = key.GetN();
 	const int knReadSize = n.NumSegments() - 1;
-	//unsigned char * pucSrcBuf,	// Big enough to hold n - 1 UShort.
-	//unsigned char * pucDstBuf		// Big enough to hold n + 2 extra UShorts.
-	unsigned char * pucSrcBuf = new unsigned char[knReadSize * sizeof( unsigned short )];
-	const size_t kunDstBufSize = ( knReadSize + 3 ) * sizeof( unsigned short );
-	unsigned char * pucDstBuf = new unsigned char[kunDstBufSize];
 	int nBytesRead = 0;
+	CRSAKeyEngine engine( key );
+	const int knBatchSize = engine.GetBatchSize();
+	CLBigNum * apX[knMultiBufferMaxLanes];
+	CLBigNum * apY[knMultiBufferMaxLanes];
+	unsigned short ausBytesEncrypted[knMultiBufferMaxLanes];
 	const int nStartTime = time( 0 );
+	int i;
+
+	for( i = 0; i < knBatchSize; ++i )
+	{
+		apX[i] = engine.GetFactory().Acquire();
+		apY[i] = engine.GetFactory().Acquire();
+	}
 
 	printf( "\nBytes encrypted: " );
 	m_version.WriteToFile( dstFile );
 
+	// Read a batch of blocks, encrypt them together, and write them out in order.
+
 	while( !feof( srcFile ) )
 	{
-		BigNum x;
-		const unsigned short kusBytesEncrypted = x.ReadFromFile( srcFile, pucSrcBuf, knReadSize );
+		int nBlocks = 0;
+
+		while( nBlocks < knBatchSize  &&  !feof( srcFile ) )
+		{
+			const unsigned short kusBytesEncrypted = apX[nBlocks]->ReadFromFile( srcFile, knReadSize );
 
 #if 1
-		if( kusBytesEncrypted == 0  &&  feof( srcFile ) )
+			if( kusBytesEncrypted == 0  &&  feof( srcFile ) )
+			{
+				break;
+			}
+#endif
+
+			Assert( *apX[nBlocks] < n );
+			ausBytesEncrypted[nBlocks++] = kusBytesEncrypted;
+		}
+
+		if( nBlocks == 0 )
 		{
 			break;
 		}
-#endif
 
-		Assert( x < n );
+		engine.Apply( apX, apY, nBlocks );
 
-		const BigNum y = ExponentMod( x, exponent, n );
+		for( i = 0; i < nBlocks; ++i )
+		{
+			apY[i]->WriteToFile( dstFile, ausBytesEncrypted[i], 0 );
+			nBytesRead += (int)ausBytesEncrypted[i];
+			printf( "%d ", nBytesRead );
+		}
+	}
 
-		memset( pucDstBuf, 0, kunDstBufSize );
-		y.WriteToFile( dstFile, pucDstBuf, kusBytesEncrypted, 0 );
-		nBytesRead += (int)kusBytesEncrypted;
-		printf( "%d ", nBytesRead );
+	for( i = 0; i < knBatchSize; ++i )
+	{
+		engine.GetFactory().Release( apX[i] );
+		engine.GetFactory().Release( apY[i] );
 	}
 
 	const int nSeconds = time( 0 ) - nStartTime;
 
 	printf( "\nEncryption finished in %d minute(s) %d second(s)\n",
 		nSeconds / 60, nSeconds % 60 );
-	delete [] pucSrcBuf;
-	delete [] pucDstBuf;
 }
 
 
 void CHelixApp::DecryptFile(
-	FILE * srcFile, FILE * dstFile,
-	const BigNum & exponent, const BigNum & n ) const
+	FILE * srcFile, FILE * dstFile, const CHelixRSAKey & key ) const
 {
-	const int knNumSegmentsInN = n.NumSegments();
-	unsigned char * pucSrcBuf = new unsigned char[( knNumSegmentsInN + 2 ) * sizeof( unsigned short )];
-	const size_t kunDstBufSize = ( knNumSegmentsInN - 1 ) * sizeof( unsigned short );
-	unsigned char * pucDstBuf = new unsigned char[kunDstBufSize];
+	const BigNum & n = key.GetN();
 	int nBytesWritten = 0;
 	const CVersion kVersion( srcFile );
+	CRSAKeyEngine engine( key );
+	const int knBatchSize = engine.GetBatchSize();
+	CLBigNum * apX[knMultiBufferMaxLanes];
+	CLBigNum * apY[knMultiBufferMaxLanes];
+	unsigned short ausBytesToWrite[knMultiBufferMaxLanes];
+	bool bBadBlock = false;
 	const int nStartTime = time( 0 );
+	int i;
+
+	for( i = 0; i < knBatchSize; ++i )
+	{
+		apX[i] = engine.GetFactory().Acquire();
+		apY[i] = engine.GetFactory().Acquire();
+	}
 
 	printf( "Encrypted file created with Helix version " );
 	kVersion.Print();
@@ -1210,32 +1935,60 @@ void CHelixApp::DecryptFile(
 
 	while( !feof( srcFile ) )
 	{
-		BigNum x;
-		const unsigned short kusBytesToWrite = x.ReadFromFile( srcFile, pucSrcBuf, 0 );
+		int nBlocks = 0;
+
+		while( nBlocks < knBatchSize  &&  !feof( srcFile ) )
+		{
+			const unsigned short kusBytesToWrite = apX[nBlocks]->ReadFromFile( srcFile, 0 );
 
 #if 1
-		if( kusBytesToWrite == 0  &&  feof( srcFile ) )
+			if( kusBytesToWrite == 0  &&  feof( srcFile ) )
+			{
+				break;
+			}
+#endif
+
+			// Every block that the key encrypted is less than n.
+
+			if( !( *apX[nBlocks] < n ) )
+			{
+				bBadBlock = true;
+				break;
+			}
+
+			ausBytesToWrite[nBlocks++] = kusBytesToWrite;
+		}
+
+		if( nBlocks == 0  ||  bBadBlock )
 		{
 			break;
 		}
-#endif
 
-		Assert( x < n );
+		engine.Apply( apX, apY, nBlocks );
+
+		for( i = 0; i < nBlocks; ++i )
+		{
+			apY[i]->WriteToFile( dstFile, 0, (size_t)ausBytesToWrite[i] );
+			nBytesWritten += (int)ausBytesToWrite[i];
+			printf( "%d ", nBytesWritten );
+		}
+	}
 
-		const BigNum y = ExponentMod( x, exponent, n );
+	for( i = 0; i < knBatchSize; ++i )
+	{
+		engine.GetFactory().Release( apX[i] );
+		engine.GetFactory().Release( apY[i] );
+	}
 
-		memset( pucDstBuf, 0, kunDstBufSize );
-		y.WriteToFile( dstFile, pucDstBuf, 0, (size_t)kusBytesToWrite );
-		nBytesWritten += (int)kusBytesToWrite;
-		printf( "%d ", nBytesWritten );
+	if( bBadBlock )
+	{
+		ThrowHelixException( "An encrypted block is not less than the key's modulus; the file is corrupt, or was encrypted with another key." );
 	}
 
 	const int nSeconds = time( 0 ) - nStartTime;
 
 	printf( "\nDecryption finished in %d minute(s) %d second(s)\n",
 		nSeconds / 60, nSeconds % 60 );
-	delete [] pucSrcBuf;
-	delete [] pucDstBuf;
 }
 
 
@@ -0,0 +1,1037 @@
+// BigNumKernels.cpp - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+#include "Common.h"
+
+
+// The portable kernels.  DigitsAdd(), DigitsSubtract(), DigitsMultiplyAdd()
+// and DigitsMontgomeryReduce() call these, or the MULX/ADX ones where the
+// processor has them; see the dispatcher below.
+
+static BigNumDigit DigitsAddPortable(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB )
+{
+	BigNumDigit ullCarry = 0;
+	int i;
+
+	for( i = 0; i < nB; ++i )
+	{
+		const BigNumDigit kullSum = pA[i] + pB[i];
+		const BigNumDigit kullCarry2 = kullSum < pA[i];
+
+		pDst[i] = kullSum + ullCarry;
+		ullCarry = kullCarry2 + ( pDst[i] < ullCarry );
+	}
+
+	for( ; i < nA; ++i )
+	{
+		pDst[i] = pA[i] + ullCarry;
+		ullCarry = pDst[i] < ullCarry;
+	}
+
+	return( ullCarry );
+}
+
+
+static BigNumDigit DigitsSubtractPortable(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB )
+{
+	BigNumDigit ullBorrow = 0;
+	int i;
+
+	for( i = 0; i < nB; ++i )
+	{
+		const BigNumDigit kullDiff = pA[i] - pB[i];
+		const BigNumDigit kullBorrow2 = pA[i] < pB[i];
+
+		pDst[i] = kullDiff - ullBorrow;
+		ullBorrow = kullBorrow2 + ( kullDiff < ullBorrow );
+	}
+
+	for( ; i < nA; ++i )
+	{
+		const BigNumDigit kullDiff = pA[i] - ullBorrow;
+
+		ullBorrow = pA[i] < ullBorrow;
+		pDst[i] = kullDiff;
+	}
+
+	return( ullBorrow );
+}
+
+
+// Returns -1, 0 or 1 as pA is less than, equal to, or greater than pB.
+
+int DigitsCompare( const BigNumDigit * pA, const BigNumDigit * pB, int n )
+{
+	int i;
+
+	for( i = n - 1; i >= 0; --i )
+	{
+
+		if( pA[i] != pB[i] )
+		{
+			return( ( pA[i] < pB[i] ) ? -1 : 1 );
+		}
+	}
+
+	return( 0 );
+}
+
+
+static BigNumDigit DigitsMultiplyAddPortable(
+	BigNumDigit * pDst, const BigNumDigit * pSrc, int nSrc, BigNumDigit ullFactor )
+{
+	// ( 2^64 - 1 )^2 + 2 * ( 2^64 - 1 ) == 2^128 - 1, so this can't overflow.
+	BigNumDoubleDigit ddCarry = 0;
+	int i;
+
+	for( i = 0; i < nSrc; ++i )
+	{
+		ddCarry += (BigNumDoubleDigit)pSrc[i] * ullFactor + pDst[i];
+		pDst[i] = (BigNumDigit)ddCarry;
+		ddCarry >>= knBitsPerDigit;
+	}
+
+	return( (BigNumDigit)ddCarry );
+}
+
+
+BigNumDigit DigitsMultiplySubtract(
+	BigNumDigit * pDst, const BigNumDigit * pSrc, int nSrc, BigNumDigit ullFactor )
+{
+	// The high digit of each product is at most 2^64 - 2, so adding a borrow can't overflow.
+	BigNumDigit ullBorrow = 0;
+	int i;
+
+	for( i = 0; i < nSrc; ++i )
+	{
+		const BigNumDoubleDigit kddProduct = (BigNumDoubleDigit)pSrc[i] * ullFactor + ullBorrow;
+		const BigNumDigit kullLow = (BigNumDigit)kddProduct;
+
+		ullBorrow = (BigNumDigit)( kddProduct >> knBitsPerDigit ) + ( pDst[i] < kullLow );
+		pDst[i] -= kullLow;
+	}
+
+	return( ullBorrow );
+}
+
+
+// Schoolbook multiplication, one row of partial products at a time.
+
+void DigitsMultiplySchoolbook(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB )
+{
+	int i;
+
+	if( pA == pB  &&  nA == nB )
+	{
+		DigitsSquareSchoolbook( pDst, pA, nA );
+		return;
+	}
+
+	memset( pDst, 0, nB * sizeof( BigNumDigit ) );
+
+	for( i = 0; i < nA; ++i )
+	{
+		pDst[i + nB] = DigitsMultiplyAdd( pDst + i, pB, nB, pA[i] );
+	}
+}
+
+
+// Each cross product a[i] * a[j], i < j, appears twice in the square,
+// so form the sum of them once, double it, and add in the squares a[i]^2.
+
+void DigitsSquareSchoolbook( BigNumDigit * pDst, const BigNumDigit * pA, int n )
+{
+	int i;
+
+	memset( pDst, 0, 2 * n * sizeof( BigNumDigit ) );
+
+	for( i = 0; i < n - 1; ++i )
+	{
+		pDst[i + n] = DigitsMultiplyAdd( pDst + 2 * i + 1, pA + i + 1, n - i - 1, pA[i] );
+	}
+
+	// Double and add the diagonal in one pass.  The sum of the cross products
+	// is less than B^2n / 2, so the doubling can't overflow.
+	BigNumDigit ullShiftedOut = 0;
+	BigNumDoubleDigit ddCarry = 0;
+
+	for( i = 0; i < n; ++i )
+	{
+		const BigNumDoubleDigit kddSquare = (BigNumDoubleDigit)pA[i] * pA[i];
+		const BigNumDigit kullLow = pDst[2 * i];
+		const BigNumDigit kullHigh = pDst[2 * i + 1];
+
+		ddCarry += (BigNumDoubleDigit)( ( kullLow << 1 ) | ullShiftedOut ) + (BigNumDigit)kddSquare;
+		pDst[2 * i] = (BigNumDigit)ddCarry;
+		ddCarry >>= knBitsPerDigit;
+		ddCarry += (BigNumDoubleDigit)( ( kullHigh << 1 ) | ( kullLow >> ( knBitsPerDigit - 1 ) ) ) +
+			(BigNumDigit)( kddSquare >> knBitsPerDigit );
+		pDst[2 * i + 1] = (BigNumDigit)ddCarry;
+		ddCarry >>= knBitsPerDigit;
+		ullShiftedOut = kullHigh >> ( knBitsPerDigit - 1 );
+	}
+}
+
+
+int DigitsKaratsubaScratchSize( int n )
+{
+
+	if( n < knKaratsubaThreshold )
+	{
+		return( 0 );
+	}
+
+	const int knHigh = n - n / 2;
+
+	// The two half sums and their product, plus the recursion below that.
+	return( 4 * ( knHigh + 1 ) + DigitsKaratsubaScratchSize( knHigh + 1 ) );
+}
+
+
+// With a = a1 * B^h + a0 and b = b1 * B^h + b0:
+// a * b = z2 * B^2h + ( ( a0 + a1 ) * ( b0 + b1 ) - z0 - z2 ) * B^h + z0,
+// where z0 = a0 * b0 and z2 = a1 * b1.
+// Using sums rather than differences keeps every intermediate non-negative.
+
+void DigitsMultiplyKaratsuba(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, const BigNumDigit * pB, int n,
+	BigNumDigit * pScratch )
+{
+
+	if( n < knKaratsubaThreshold )
+	{
+		DigitsMultiplySchoolbook( pDst, pA, n, pB, n );
+		return;
+	}
+
+	const int knLow = n / 2;
+	const int knHigh = n - knLow;
+	const int knSumSize = knHigh + 1;
+	BigNumDigit * pSumA = pScratch;
+	BigNumDigit * pSumB = pSumA + knSumSize;
+	BigNumDigit * pMiddle = pSumB + knSumSize;
+	BigNumDigit * pNextScratch = pMiddle + 2 * knSumSize;
+
+	// z0 and z2 go straight into the low and high halves of the product.
+	DigitsMultiplyKaratsuba( pDst, pA, pB, knLow, pScratch );
+	DigitsMultiplyKaratsuba( pDst + 2 * knLow, pA + knLow, pB + knLow, knHigh, pScratch );
+
+	pSumA[knHigh] = DigitsAdd( pSumA, pA + knLow, knHigh, pA, knLow );
+
+	if( pA == pB )
+	{
+		// Squaring: all three products are squares.
+		DigitsMultiplyKaratsuba( pMiddle, pSumA, pSumA, knSumSize, pNextScratch );
+	}
+	else
+	{
+		pSumB[knHigh] = DigitsAdd( pSumB, pB + knLow, knHigh, pB, knLow );
+		DigitsMultiplyKaratsuba( pMiddle, pSumA, pSumB, knSumSize, pNextScratch );
+	}
+
+	DigitsSubtract( pMiddle, pMiddle, 2 * knSumSize, pDst, 2 * knLow );
+	DigitsSubtract( pMiddle, pMiddle, 2 * knSumSize, pDst + 2 * knLow, 2 * knHigh );
+
+	// The middle term is less than B^( n + 1 ), so only that much of it
+	// needs to be added in; the carries stop within the product.
+	const int knMiddleSize = n + 1 < 2 * knSumSize ? n + 1 : 2 * knSumSize;
+
+	DigitsAdd( pDst + knLow, pDst + knLow, 2 * n - knLow, pMiddle, knMiddleSize );
+}
+
+
+// Toom-3 helpers.  The interpolation works on fixed-width values
+// in two's complement, so intermediate results may be negative.
+
+static void DigitsNegate( BigNumDigit * p, int n )
+{
+	BigNumDigit ullCarry = 1;
+	int i;
+
+	for( i = 0; i < n; ++i )
+	{
+		p[i] = ~p[i] + ullCarry;
+		ullCarry = ullCarry  &&  p[i] == 0;
+	}
+}
+
+
+// Shift right by one bit, preserving the sign.
+
+static void DigitsHalveSigned( BigNumDigit * p, int n )
+{
+	int i;
+
+	for( i = 0; i < n - 1; ++i )
+	{
+		p[i] = ( p[i] >> 1 ) | ( p[i + 1] << ( knBitsPerDigit - 1 ) );
+	}
+
+	p[n - 1] = (BigNumDigit)( (long long)p[n - 1] >> 1 );
+}
+
+
+// Divide by 3, where the value is known to be a multiple of 3.
+// This is Hensel division, so it is also exact for negative values.
+
+static void DigitsDivideExactBy3( BigNumDigit * p, int n )
+{
+	const BigNumDigit kullInverseOf3 = 0xAAAAAAAAAAAAAAABULL;	// 3 * this == 1 mod 2^64.
+	const BigNumDigit kullOneThird = 0x5555555555555556ULL;		// ceil( 2^64 / 3 )
+	const BigNumDigit kullTwoThirds = 0xAAAAAAAAAAAAAAABULL;	// ceil( 2^65 / 3 )
+	BigNumDigit ullBorrow = 0;
+	int i;
+
+	for( i = 0; i < n; ++i )
+	{
+		const BigNumDigit kullDigit = p[i] - ullBorrow;
+		const BigNumDigit kullQuotient = kullDigit * kullInverseOf3;
+
+		// The new borrow is the high digit of 3 * kullQuotient, plus the old borrow out.
+		ullBorrow = ( p[i] < ullBorrow ) + ( kullQuotient >= kullOneThird ) + ( kullQuotient >= kullTwoThirds );
+		p[i] = kullQuotient;
+	}
+}
+
+
+// pDst[0 .. n] = pSrc[0 .. nSrc - 1] << nShift, where n >= nSrc and nShift < 64.
+
+static void DigitsShiftLeftInto(
+	BigNumDigit * pDst, int n,
+	const BigNumDigit * pSrc, int nSrc, int nShift )
+{
+	int i;
+
+	memset( pDst, 0, ( n + 1 ) * sizeof( BigNumDigit ) );
+	memcpy( pDst, pSrc, nSrc * sizeof( BigNumDigit ) );
+
+	if( nShift == 0 )
+	{
+		return;
+	}
+
+	for( i = n; i > 0; --i )
+	{
+		pDst[i] = ( pDst[i] << nShift ) | ( pDst[i - 1] >> ( knBitsPerDigit - nShift ) );
+	}
+
+	pDst[0] <<= nShift;
+}
+
+
+// Sets pDst[0 .. nA] = | pA - ( pB << nShift ) + ( pC << 2 * nShift ) |,
+// and returns true if that sum is negative.
+// This evaluates a + b * x + c * x^2 at x = -1 or x = -2.
+
+static bool DigitsEvaluateAtNegative(
+	BigNumDigit * pDst, BigNumDigit * pTemp,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB,
+	const BigNumDigit * pC, int nC,
+	int nShift )
+{
+	int i;
+
+	DigitsShiftLeftInto( pTemp, nA, pC, nC, 2 * nShift );
+	DigitsAdd( pTemp, pTemp, nA + 1, pA, nA );
+	DigitsShiftLeftInto( pDst, nA, pB, nB, nShift );
+
+	for( i = nA; i >= 0; --i )
+	{
+
+		if( pTemp[i] != pDst[i] )
+		{
+			break;
+		}
+	}
+
+	if( i >= 0  &&  pTemp[i] < pDst[i] )
+	{
+		DigitsSubtract( pDst, pDst, nA + 1, pTemp, nA + 1 );
+		return( true );
+	}
+
+	DigitsSubtract( pDst, pTemp, nA + 1, pDst, nA + 1 );
+	return( false );
+}
+
+
+int DigitsToom3ScratchSize( int n )
+{
+	const int knPart = ( n + 2 ) / 3;
+
+	// Six evaluations, three pointwise products, and the recursion below.
+	return( 6 * ( knPart + 1 ) + 3 * ( 2 * knPart + 2 ) + DigitsMultiplyScratchSize( knPart + 1 ) );
+}
+
+
+// Split each operand into three parts, a = a2 * x^2 + a1 * x + a0 with x = B^k,
+// evaluate at 0, 1, -1, -2 and infinity, multiply pointwise,
+// and interpolate with Bodrato's sequence.
+
+void DigitsMultiplyToom3(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, const BigNumDigit * pB, int n,
+	BigNumDigit * pScratch )
+{
+	const int knPart = ( n + 2 ) / 3;
+	const int knTopPart = n - 2 * knPart;
+	const int knEvalSize = knPart + 1;
+	const int knWidth = 2 * knEvalSize;
+	const BigNumDigit * pA0 = pA;
+	const BigNumDigit * pA1 = pA + knPart;
+	const BigNumDigit * pA2 = pA + 2 * knPart;
+	const BigNumDigit * pB0 = pB;
+	const BigNumDigit * pB1 = pB + knPart;
+	const BigNumDigit * pB2 = pB + 2 * knPart;
+	BigNumDigit * pA1Eval = pScratch;
+	BigNumDigit * pAM1Eval = pA1Eval + knEvalSize;
+	BigNumDigit * pAM2Eval = pAM1Eval + knEvalSize;
+	BigNumDigit * pB1Eval = pAM2Eval + knEvalSize;
+	BigNumDigit * pBM1Eval = pB1Eval + knEvalSize;
+	BigNumDigit * pBM2Eval = pBM1Eval + knEvalSize;
+	BigNumDigit * pR1 = pBM2Eval + knEvalSize;
+	BigNumDigit * pRM1 = pR1 + knWidth;
+	BigNumDigit * pRM2 = pRM1 + knWidth;
+	BigNumDigit * pNextScratch = pRM2 + knWidth;
+	BigNumDigit * pR0 = pDst;
+	BigNumDigit * pRInf = pDst + 4 * knPart;
+	const int knRInfSize = 2 * knTopPart;
+
+	// Evaluate.  pR1 serves as temporary space for the negative points.
+	pA1Eval[knPart] = DigitsAdd( pA1Eval, pA0, knPart, pA2, knTopPart );
+	pA1Eval[knPart] += DigitsAdd( pA1Eval, pA1Eval, knPart, pA1, knPart );
+
+	bool bM1Negative = DigitsEvaluateAtNegative( pAM1Eval, pR1, pA0, knPart, pA1, knPart, pA2, knTopPart, 0 );
+	bool bM2Negative = DigitsEvaluateAtNegative( pAM2Eval, pR1, pA0, knPart, pA1, knPart, pA2, knTopPart, 1 );
+
+	if( pA == pB )
+	{
+		// Squaring: evaluate once, so that the pointwise products are squares too.
+		// A square is never negative.
+		pB1Eval = pA1Eval;
+		pBM1Eval = pAM1Eval;
+		pBM2Eval = pAM2Eval;
+		bM1Negative = false;
+		bM2Negative = false;
+	}
+	else
+	{
+		pB1Eval[knPart] = DigitsAdd( pB1Eval, pB0, knPart, pB2, knTopPart );
+		pB1Eval[knPart] += DigitsAdd( pB1Eval, pB1Eval, knPart, pB1, knPart );
+		bM1Negative = bM1Negative != DigitsEvaluateAtNegative( pBM1Eval, pR1, pB0, knPart, pB1, knPart, pB2, knTopPart, 0 );
+		bM2Negative = bM2Negative != DigitsEvaluateAtNegative( pBM2Eval, pR1, pB0, knPart, pB1, knPart, pB2, knTopPart, 1 );
+	}
+
+	// Multiply pointwise.  r(0) and r(infinity) go straight into the product.
+	DigitsMultiplyBalanced( pR1, pA1Eval, pB1Eval, knEvalSize, pNextScratch );
+	DigitsMultiplyBalanced( pRM1, pAM1Eval, pBM1Eval, knEvalSize, pNextScratch );
+	DigitsMultiplyBalanced( pRM2, pAM2Eval, pBM2Eval, knEvalSize, pNextScratch );
+	DigitsMultiplyBalanced( pR0, pA0, pB0, knPart, pNextScratch );
+	DigitsMultiplyBalanced( pRInf, pA2, pB2, knTopPart, pNextScratch );
+	memset( pDst + 2 * knPart, 0, 2 * knPart * sizeof( BigNumDigit ) );
+
+	if( bM1Negative )
+	{
+		DigitsNegate( pRM1, knWidth );
+	}
+
+	if( bM2Negative )
+	{
+		DigitsNegate( pRM2, knWidth );
+	}
+
+	// Interpolate.  Afterwards pR1, pRM1 and pRM2 hold r1, r2 and r3.
+	DigitsSubtract( pRM2, pRM2, knWidth, pR1, knWidth );		// r(-2) - r(1)
+	DigitsDivideExactBy3( pRM2, knWidth );						// r3 = ( r(-2) - r(1) ) / 3
+	DigitsSubtract( pR1, pR1, knWidth, pRM1, knWidth );			// r(1) - r(-1)
+	DigitsHalveSigned( pR1, knWidth );							// r1 = ( r(1) - r(-1) ) / 2
+	DigitsSubtract( pRM1, pRM1, knWidth, pR0, 2 * knPart );		// r2 = r(-1) - r(0)
+	DigitsSubtract( pRM2, pRM1, knWidth, pRM2, knWidth );		// r2 - r3
+	DigitsHalveSigned( pRM2, knWidth );							// ( r2 - r3 ) / 2
+	DigitsAdd( pRM2, pRM2, knWidth, pRInf, knRInfSize );
+	DigitsAdd( pRM2, pRM2, knWidth, pRInf, knRInfSize );		// r3 = ( r2 - r3 ) / 2 + 2 * r(inf)
+	DigitsAdd( pRM1, pRM1, knWidth, pR1, knWidth );
+	DigitsSubtract( pRM1, pRM1, knWidth, pRInf, knRInfSize );	// r2 = r2 + r1 - r(inf)
+	DigitsSubtract( pR1, pR1, knWidth, pRM2, knWidth );			// r1 = r1 - r3
+
+	// Recompose.  Each coefficient is non-negative, and the digits that
+	// would fall beyond the end of the product are zero.
+	int i;
+
+	for( i = 1; i <= 3; ++i )
+	{
+		const BigNumDigit * kpCoefficient = ( i == 1 ) ? pR1 : ( i == 2 ) ? pRM1 : pRM2;
+		const int knOffset = i * knPart;
+		const int knSize = knWidth < 2 * n - knOffset ? knWidth : 2 * n - knOffset;
+
+		DigitsAdd( pDst + knOffset, pDst + knOffset, 2 * n - knOffset, kpCoefficient, knSize );
+	}
+}
+
+
+int DigitsMultiplyScratchSize( int n )
+{
+
+	if( n >= knNTTThreshold )
+	{
+		return( 0 );
+	}
+	else if( n >= knToom3Threshold )
+	{
+		return( DigitsToom3ScratchSize( n ) );
+	}
+
+	return( DigitsKaratsubaScratchSize( n ) );
+}
+
+
+void DigitsMultiplyBalanced(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, const BigNumDigit * pB, int n,
+	BigNumDigit * pScratch )
+{
+
+	if( n >= knNTTThreshold )
+	{
+		DigitsMultiplyNTT( pDst, pA, n, pB, n );
+	}
+	else if( n >= knToom3Threshold )
+	{
+		DigitsMultiplyToom3( pDst, pA, pB, n, pScratch );
+	}
+	else if( n >= knKaratsubaThreshold )
+	{
+		DigitsMultiplyKaratsuba( pDst, pA, pB, n, pScratch );
+	}
+	else
+	{
+		DigitsMultiplySchoolbook( pDst, pA, n, pB, n );
+	}
+}
+
+
+void DigitsMultiply(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB )
+{
+
+	if( nA < nB )
+	{
+		DigitsMultiply( pDst, pB, nB, pA, nA );
+		return;
+	}
+
+	if( nB < knKaratsubaThreshold )
+	{
+		DigitsMultiplySchoolbook( pDst, pA, nA, pB, nB );
+		return;
+	}
+
+	if( nB >= knNTTThreshold )
+	{
+		DigitsMultiplyNTT( pDst, pA, nA, pB, nB );
+		return;
+	}
+
+	// Allocate the scratch space once, for the whole recursion.
+	const int knScratchSize = DigitsMultiplyScratchSize( nB );
+	CBigNumArenaScope scope;
+	BigNumDigit * pScratch = scope.Allocate<BigNumDigit>( knScratchSize + 2 * nB );
+	BigNumDigit * pChunkProduct = pScratch + knScratchSize;
+
+	if( nA == nB )
+	{
+		DigitsMultiplyBalanced( pDst, pA, pB, nB, pScratch );
+		return;
+	}
+
+	// Multiply B by successive nB-digit chunks of A, and add the products in.
+	int i;
+
+	memset( pDst, 0, ( nA + nB ) * sizeof( BigNumDigit ) );
+
+	for( i = 0; i < nA; i += nB )
+	{
+		const int knChunkSize = nA - i < nB ? nA - i : nB;
+
+		if( knChunkSize == nB )
+		{
+			DigitsMultiplyBalanced( pChunkProduct, pA + i, pB, nB, pScratch );
+		}
+		else
+		{
+			DigitsMultiply( pChunkProduct, pB, nB, pA + i, knChunkSize );
+		}
+
+		DigitsAdd( pDst + i, pDst + i, nA + nB - i, pChunkProduct, knChunkSize + nB );
+	}
+}
+
+
+void DigitsSquare( BigNumDigit * pDst, const BigNumDigit * pA, int n )
+{
+	DigitsMultiply( pDst, pA, n, pA, n );
+}
+
+
+
+// Montgomery's REDC, one digit at a time: adding a multiple of N clears
+// the low digit of T at each step, and the high half is then T / B^n mod N.
+
+static void DigitsMontgomeryReducePortable(
+	BigNumDigit * pDst, BigNumDigit * pT,
+	const BigNumDigit * pN, int n, BigNumDigit ullNInverse )
+{
+	// ullCarry is the carry into pT[i + n + 1], which the next step adds in.
+	BigNumDigit ullCarry = 0;
+	int i;
+
+	for( i = 0; i < n; ++i )
+	{
+		const BigNumDigit kullProductCarry = DigitsMultiplyAddPortable( pT + i, pN, n, pT[i] * ullNInverse );
+		BigNumDigit ullSum = pT[i + n] + kullProductCarry;
+		const BigNumDigit kullCarry1 = ullSum < kullProductCarry;
+
+		ullSum += ullCarry;
+		ullCarry = kullCarry1 + ( ullSum < ullCarry );
+		pT[i + n] = ullSum;
+	}
+
+	// The result is less than 2N, so at most one subtraction is needed.
+
+	if( ullCarry != 0  ||  DigitsCompare( pT + n, pN, n ) >= 0 )
+	{
+		DigitsSubtractPortable( pDst, pT + n, n, pN, n );
+	}
+	else if( pDst != pT + n )
+	{
+		memcpy( pDst, pT + n, n * sizeof( BigNumDigit ) );
+	}
+}
+
+
+// The kernel dispatcher.  It starts out pointing to the portable kernels,
+// so anything that runs before the static initializer below (such as
+// the construction of other static objects) still works; the initializer
+// then switches to the MULX/ADX kernels if CPUID says the processor has them.
+
+class CDigitsKernels
+{
+public:
+	BigNumDigit (*m_pfnAdd)( BigNumDigit *, const BigNumDigit *, int, const BigNumDigit *, int );
+	BigNumDigit (*m_pfnSubtract)( BigNumDigit *, const BigNumDigit *, int, const BigNumDigit *, int );
+	BigNumDigit (*m_pfnMultiplyAdd)( BigNumDigit *, const BigNumDigit *, int, BigNumDigit );
+	void (*m_pfnMontgomeryReduce)( BigNumDigit *, BigNumDigit *, const BigNumDigit *, int, BigNumDigit );
+	const char * m_pcName;
+}; // class CDigitsKernels
+
+
+static const CDigitsKernels kPortableKernels =
+{
+	DigitsAddPortable,
+	DigitsSubtractPortable,
+	DigitsMultiplyAddPortable,
+	DigitsMontgomeryReducePortable,
+	"portable"
+};
+
+#ifdef _HELIX_X86_64_KERNELS_
+static const CDigitsKernels kMulxAdxKernels =
+{
+	DigitsAddMulxAdx,
+	DigitsSubtractMulxAdx,
+	DigitsMultiplyAddMulxAdx,
+	DigitsMontgomeryReduceMulxAdx,
+	"MULX/ADX"
+};
+#endif
+
+static const CDigitsKernels * s_pKernels = &kPortableKernels;
+static const bool s_kbFastKernelsSelected = DigitsUseFastKernels( true );
+
+
+bool DigitsUseFastKernels( bool bUseFast )
+{
+	s_pKernels = &kPortableKernels;
+
+#ifdef _HELIX_X86_64_KERNELS_
+	if( bUseFast  &&  DigitsCPUHasMulxAdx() )
+	{
+		s_pKernels = &kMulxAdxKernels;
+		return( true );
+	}
+#endif
+
+	return( false );
+}
+
+
+bool DigitsFastKernelsInUse( void )
+{
+	return( s_pKernels != &kPortableKernels );
+}
+
+
+const char * DigitsKernelsName( void )
+{
+	return( s_pKernels->m_pcName );
+}
+
+
+BigNumDigit DigitsAdd(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB )
+{
+	return( s_pKernels->m_pfnAdd( pDst, pA, nA, pB, nB ) );
+}
+
+
+BigNumDigit DigitsSubtract(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB )
+{
+	return( s_pKernels->m_pfnSubtract( pDst, pA, nA, pB, nB ) );
+}
+
+
+BigNumDigit DigitsMultiplyAdd(
+	BigNumDigit * pDst, const BigNumDigit * pSrc, int nSrc, BigNumDigit ullFactor )
+{
+	return( s_pKernels->m_pfnMultiplyAdd( pDst, pSrc, nSrc, ullFactor ) );
+}
+
+
+void DigitsMontgomeryReduce(
+	BigNumDigit * pDst, BigNumDigit * pT,
+	const BigNumDigit * pN, int n, BigNumDigit ullNInverse )
+{
+	s_pKernels->m_pfnMontgomeryReduce( pDst, pT, pN, n, ullNInverse );
+}
+
+// Knuth, "The Art of Computer Programming", vol. 2, section 4.3.1, Algorithm D.
+// pQ[0 .. nQ - 1] = pU / pV, and pU[0 .. nV - 1] = pU % pV, where pU has nQ + nV digits,
+// pV is normalized (its top bit is set), nV >= 2, and the top nV digits of pU are less than pV.
+// Each quotient digit is estimated from the top three digits of the running
+// remainder and the top two of the divisor, and is at most one too big.
+
+static void DigitsDivideSchoolbook(
+	BigNumDigit * pQ, BigNumDigit * pU, int nQ,
+	const BigNumDigit * pV, int nV )
+{
+	const BigNumDigit kullV1 = pV[nV - 1];
+	const BigNumDigit kullV2 = pV[nV - 2];
+	const BigNumDoubleDigit kddBase = (BigNumDoubleDigit)1 << knBitsPerDigit;
+	int i;
+
+	for( i = nQ - 1; i >= 0; --i )
+	{
+		BigNumDigit * pWindow = pU + i;
+		const BigNumDoubleDigit kddNumerator = ( (BigNumDoubleDigit)pWindow[nV] << knBitsPerDigit ) | pWindow[nV - 1];
+		BigNumDoubleDigit ddQHat = kddNumerator / kullV1;
+		BigNumDoubleDigit ddRHat = kddNumerator - ddQHat * kullV1;
+
+		while( ddQHat >= kddBase  ||
+			ddQHat * kullV2 > ( ( ddRHat << knBitsPerDigit ) | pWindow[nV - 2] ) )
+		{
+			--ddQHat;
+			ddRHat += kullV1;
+
+			if( ddRHat >= kddBase )
+			{
+				break;
+			}
+		}
+
+		// Multiply and subtract; if that went negative, q-hat was one too big.
+		BigNumDigit ullQHat = (BigNumDigit)ddQHat;
+		const BigNumDigit kullBorrow = DigitsMultiplySubtract( pWindow, pV, nV, ullQHat );
+		const bool kbNegative = pWindow[nV] < kullBorrow;
+
+		pWindow[nV] -= kullBorrow;
+
+		if( kbNegative )
+		{
+			--ullQHat;
+			pWindow[nV] += DigitsAdd( pWindow, pWindow, nV, pV, nV );
+		}
+
+		pQ[i] = ullQHat;
+	}
+}
+
+
+// Subtracts 1 from pDst[0 .. n - 1], and returns the borrow.
+
+static BigNumDigit DigitsDecrement( BigNumDigit * pDst, int n )
+{
+	int i;
+
+	for( i = 0; i < n; ++i )
+	{
+
+		if( pDst[i]-- != 0 )
+		{
+			return( 0 );
+		}
+	}
+
+	return( 1 );
+}
+
+
+// Adds 1 to pDst[0 .. n - 1], and returns the carry.
+
+static BigNumDigit DigitsIncrement( BigNumDigit * pDst, int n )
+{
+	int i;
+
+	for( i = 0; i < n; ++i )
+	{
+
+		if( ++pDst[i] != 0 )
+		{
+			return( 0 );
+		}
+	}
+
+	return( 1 );
+}
+
+
+static BigNumDigit DigitsDivideRecursive(
+	BigNumDigit * pQ, BigNumDigit * pU, int nQ,
+	const BigNumDigit * pV, int nV,
+	BigNumDigit * pScratch );
+
+
+// DigitsDivideRecursive() for a quotient shorter than the divisor, as in the
+// remainder trees of BatchGCD(), where a number is often reduced by one only a
+// little smaller.  The quotient depends mostly on the top of the divisor, so
+// with s = nV - nQ, the top 2 * nQ digits of pU are divided by the top nQ digits
+// of pV.  That quotient is never too small, and at most a little too large,
+// which the final correction takes care of.  The rest of pV then costs
+// one unbalanced product, instead of a pass over all nV digits for every
+// few digits of the quotient.
+
+static BigNumDigit DigitsDivideShortQuotient(
+	BigNumDigit * pQ, BigNumDigit * pU, int nQ,
+	const BigNumDigit * pV, int nV,
+	BigNumDigit * pScratch )
+{
+	const int knLowDigits = nV - nQ;
+	CBigNumArenaScope scope;
+	BigNumDigit * pProduct = scope.Allocate<BigNumDigit>( nV );
+	BigNumDigit ullQHigh;
+	BigNumDigit ullBorrow;
+
+	// ( Q, R1 ) = ( U / B^s ) divided by V1 = V / B^s.
+	ullQHigh = DigitsDivideRecursive( pQ, pU + knLowDigits, nQ, pV + knLowDigits, nQ, pScratch );
+
+	// U' = R1 * B^s + ( U mod B^s ) - Q * V0.
+	DigitsMultiply( pProduct, pV, knLowDigits, pQ, nQ );
+	ullBorrow = DigitsSubtract( pU, pU, nV, pProduct, nV );
+
+	if( ullQHigh != 0 )
+	{
+		ullBorrow += DigitsSubtract( pU + nQ, pU + nQ, knLowDigits, pV, knLowDigits );
+	}
+
+	while( ullBorrow != 0 )
+	{
+		ullQHigh -= DigitsDecrement( pQ, nQ );
+		ullBorrow -= DigitsAdd( pU, pU, nV, pV, nV );
+	}
+
+	return( ullQHigh );
+}
+
+
+// Divide-and-conquer division; see Brent and Zimmermann, "Modern Computer
+// Arithmetic", Algorithm 1.8 (after Burnikel and Ziegler).
+// pQ[0 .. nQ - 1] = pU / pV, and pU[0 .. nV - 1] = pU % pV, where pU has nQ + nV digits,
+// pV is normalized, and nQ <= nV.  The quotient may need one more digit,
+// which is returned (0 or 1).  The top nQ digits of pU are left zero.
+// Half the quotient comes from dividing the top of pU by the top half of pV;
+// multiplying by the low half of pV then corrects the partial remainder.
+// pScratch must hold nQ digits.
+
+static BigNumDigit DigitsDivideRecursive(
+	BigNumDigit * pQ, BigNumDigit * pU, int nQ,
+	const BigNumDigit * pV, int nV,
+	BigNumDigit * pScratch )
+{
+	BigNumDigit ullQHigh = 0;
+
+	if( nQ < knDivideRecursiveThreshold )
+	{
+
+		if( DigitsCompare( pU + nQ, pV, nV ) >= 0 )
+		{
+			DigitsSubtract( pU + nQ, pU + nQ, nV, pV, nV );
+			ullQHigh = 1;
+		}
+
+		DigitsDivideSchoolbook( pQ, pU, nQ, pV, nV );
+		return( ullQHigh );
+	}
+
+	if( nV > nQ )
+	{
+		return( DigitsDivideShortQuotient( pQ, pU, nQ, pV, nV, pScratch ) );
+	}
+
+	const int knLow = nQ / 2;
+	const int knHigh = nQ - knLow;
+	const BigNumDigit * kpV1 = pV + knLow;
+	const int knV1Digits = nV - knLow;
+	BigNumDigit * pQ1 = pQ + knLow;
+	BigNumDigit ullBorrow;
+
+	// ( Q1, R1 ) = ( U / B^2k ) divided by V1, where k = knLow.
+	ullQHigh = DigitsDivideRecursive( pQ1, pU + 2 * knLow, knHigh, kpV1, knV1Digits, pScratch );
+
+	// U' = R1 * B^2k + ( U mod B^2k ) - Q1 * V0 * B^k.
+	DigitsMultiply( pScratch, pQ1, knHigh, pV, knLow );
+	ullBorrow = DigitsSubtract( pU + knLow, pU + knLow, nV, pScratch, nQ );
+
+	if( ullQHigh != 0 )
+	{
+		ullBorrow += DigitsSubtract( pU + nQ, pU + nQ, nV + knLow - nQ, pV, knLow );
+	}
+
+	while( ullBorrow != 0 )
+	{
+		ullQHigh -= DigitsDecrement( pQ1, knHigh );
+		ullBorrow -= DigitsAdd( pU + knLow, pU + knLow, nV, pV, nV );
+	}
+
+	// ( Q0, R0 ) = ( U' / B^k ) divided by V1.
+	BigNumDigit ullQ0High = DigitsDivideRecursive( pQ, pU + knLow, knLow, kpV1, knV1Digits, pScratch );
+
+	// U'' = R0 * B^k + ( U' mod B^k ) - Q0 * V0.
+	DigitsMultiply( pScratch, pQ, knLow, pV, knLow );
+	ullBorrow = DigitsSubtract( pU, pU, nV, pScratch, 2 * knLow );
+
+	if( ullQ0High != 0 )
+	{
+		ullBorrow += DigitsSubtract( pU + knLow, pU + knLow, knV1Digits, pV, knLow );
+	}
+
+	while( ullBorrow != 0 )
+	{
+		ullQ0High -= DigitsDecrement( pQ, knLow );
+		ullBorrow -= DigitsAdd( pU, pU, nV, pV, nV );
+	}
+
+	if( ullQ0High != 0 )
+	{
+		ullQHigh += DigitsIncrement( pQ1, knHigh );
+	}
+
+	return( ullQHigh );
+}
+
+
+// Both operands are shifted left so that the divisor's top bit is set.
+// Large divisors are then handled recursively, nV quotient digits at a time.
+
+void DigitsDivide(
+	BigNumDigit * pQuotient, BigNumDigit * pRemainder,
+	const BigNumDigit * pU, int nU,
+	const BigNumDigit * pV, int nV )
+{
+	const int knShift = __builtin_clzll( pV[nV - 1] );
+	const int knQuotientDigits = nU - nV + 1;
+	int i;
+
+	if( nV == 1 )
+	{
+		// Short division.
+		BigNumDigit ullRemainder = 0;
+
+		for( i = nU - 1; i >= 0; --i )
+		{
+			const BigNumDoubleDigit kddNumerator = ( (BigNumDoubleDigit)ullRemainder << knBitsPerDigit ) | pU[i];
+			const BigNumDigit kullQuotientDigit = (BigNumDigit)( kddNumerator / pV[0] );
+
+			ullRemainder = (BigNumDigit)( kddNumerator - (BigNumDoubleDigit)kullQuotientDigit * pV[0] );
+
+			if( pQuotient != 0 )
+			{
+				pQuotient[i] = kullQuotientDigit;
+			}
+		}
+
+		if( pRemainder != 0 )
+		{
+			pRemainder[0] = ullRemainder;
+		}
+
+		return;
+	}
+
+	// vV and vU are the normalized divisor and dividend; vU has an extra top digit,
+	// which is less than vV's top digit.  The quotient is always formed,
+	// since the recursive method needs it.
+	CBigNumArenaScope scope;
+	BigNumDigit * pNormV = scope.Allocate<BigNumDigit>( nV + 1 );
+	BigNumDigit * pNormU = scope.Allocate<BigNumDigit>( nU + 1 );
+	BigNumDigit * pQ = ( pQuotient == 0 ) ? scope.Allocate<BigNumDigit>( knQuotientDigits ) : pQuotient;
+
+	DigitsShiftLeftInto( pNormV, nV, pV, nV, knShift );
+	DigitsShiftLeftInto( pNormU, nU, pU, nU, knShift );
+
+	if( nV < knDivideRecursiveThreshold )
+	{
+		DigitsDivideSchoolbook( pQ, pNormU, knQuotientDigits, pNormV, nV );
+	}
+	else
+	{
+		BigNumDigit * pScratch = scope.Allocate<BigNumDigit>( nV );
+		int nChunkSize = knQuotientDigits % nV;
+
+		if( nChunkSize == 0 )
+		{
+			nChunkSize = nV;
+		}
+
+		// The top nV digits of each chunk are the remainder so far, which is less than vV,
+		// so no chunk's quotient needs an extra digit.
+
+		for( i = knQuotientDigits - nChunkSize; i >= 0; i -= nV )
+		{
+			DigitsDivideRecursive( pQ + i, pNormU + i, nChunkSize, pNormV, nV, pScratch );
+			nChunkSize = nV;
+		}
+	}
+
+	// Unnormalize the remainder.
+
+	if( pRemainder != 0 )
+	{
+
+		for( i = 0; i < nV; ++i )
+		{
+			pRemainder[i] = ( knShift == 0 ) ? pNormU[i] :
+				( pNormU[i] >> knShift ) | ( pNormU[i + 1] << ( knBitsPerDigit - knShift ) );
+		}
+	}
+}
+
+
+// **** End of File ****
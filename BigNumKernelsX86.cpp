@@ -0,0 +1,215 @@
+// BigNumKernelsX86.cpp - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// Digit kernels for x86-64 processors with the BMI2 and ADX extensions.
+
+// MULX multiplies without touching the flags, and ADCX and ADOX add with
+// carry through CF and OF respectively, leaving the other flag alone.
+// So a row of a multiplication can keep two carry chains in flight at once:
+// one adding each product's low digit to the previous product's high digit,
+// and one adding that sum into the destination.  Compilers won't interleave
+// the chains on their own, so the row is written in assembly; the loops
+// are controlled with LEA and JRCXZ, which don't change the flags either.
+
+// The dispatcher in BigNumKernels.cpp only calls these after
+// DigitsCPUHasMulxAdx() has returned true.
+
+#include "Common.h"
+
+#ifdef _HELIX_X86_64_KERNELS_
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+
+bool DigitsCPUHasMulxAdx( void )
+{
+	unsigned int unEAX = 0;
+	unsigned int unEBX = 0;
+	unsigned int unECX = 0;
+	unsigned int unEDX = 0;
+
+	// Leaf 7, subleaf 0: the structured extended feature flags.
+
+	if( !__get_cpuid_count( 7, 0, &unEAX, &unEBX, &unECX, &unEDX ) )
+	{
+		return( false );
+	}
+
+	return( ( unEBX & bit_BMI2 ) != 0  &&  ( unEBX & bit_ADX ) != 0 );
+}
+
+
+// pDst[0 .. nSrc - 1] += pSrc[0 .. nSrc - 1] * ullFactor; returns the carry.
+// Column i gets the low digit of product i, the high digit of product i - 1,
+// and pDst[i]; the first sum carries through CF, and the second through OF.
+// At the end, both carries go into the high digit of the last product,
+// which can't overflow, since the whole result fits in nSrc + 1 digits.
+// Up to three digits are done one at a time, and the rest four at a time.
+
+static inline BigNumDigit MultiplyAddRow(
+	BigNumDigit * pDst, const BigNumDigit * pSrc, int nSrc, BigNumDigit ullFactor )
+{
+	const size_t kunSingles = (size_t)nSrc & 3;
+	const size_t kunQuads = (size_t)nSrc >> 2;
+	BigNumDigit ullCarry;
+
+	__asm__ __volatile__(
+		"xorl %%eax, %%eax\n\t"				// Clears CF and OF too
+		"movq %[singles], %%rcx\n\t"
+		"jrcxz 2f\n"
+		"1:\n\t"
+		"mulxq (%[src]), %%r8, %%r9\n\t"
+		"adcxq %%rax, %%r8\n\t"
+		"adoxq (%[dst]), %%r8\n\t"
+		"movq %%r8, (%[dst])\n\t"
+		"movq %%r9, %%rax\n\t"
+		"leaq 8(%[src]), %[src]\n\t"
+		"leaq 8(%[dst]), %[dst]\n\t"
+		"leaq -1(%%rcx), %%rcx\n\t"
+		"jrcxz 2f\n\t"
+		"jmp 1b\n"
+		"2:\n\t"
+		"movq %[quads], %%rcx\n\t"
+		"jrcxz 4f\n"
+		"3:\n\t"
+		"mulxq (%[src]), %%r8, %%r9\n\t"
+		"adcxq %%rax, %%r8\n\t"
+		"adoxq (%[dst]), %%r8\n\t"
+		"movq %%r8, (%[dst])\n\t"
+		"mulxq 8(%[src]), %%r10, %%rax\n\t"
+		"adcxq %%r9, %%r10\n\t"
+		"adoxq 8(%[dst]), %%r10\n\t"
+		"movq %%r10, 8(%[dst])\n\t"
+		"mulxq 16(%[src]), %%r8, %%r9\n\t"
+		"adcxq %%rax, %%r8\n\t"
+		"adoxq 16(%[dst]), %%r8\n\t"
+		"movq %%r8, 16(%[dst])\n\t"
+		"mulxq 24(%[src]), %%r10, %%rax\n\t"
+		"adcxq %%r9, %%r10\n\t"
+		"adoxq 24(%[dst]), %%r10\n\t"
+		"movq %%r10, 24(%[dst])\n\t"
+		"leaq 32(%[src]), %[src]\n\t"
+		"leaq 32(%[dst]), %[dst]\n\t"
+		"leaq -1(%%rcx), %%rcx\n\t"
+		"jrcxz 4f\n\t"
+		"jmp 3b\n"
+		"4:\n\t"
+		"movl $0, %%r8d\n\t"
+		"adcxq %%r8, %%rax\n\t"
+		"adoxq %%r8, %%rax\n\t"
+		: "=&a" ( ullCarry ), [src] "+r" ( pSrc ), [dst] "+r" ( pDst )
+		: [singles] "r" ( kunSingles ), [quads] "r" ( kunQuads ), "d" ( ullFactor )
+		: "rcx", "r8", "r9", "r10", "cc", "memory" );
+
+	return( ullCarry );
+}
+
+
+// Addition and subtraction have only one carry chain, so the intrinsics,
+// which compile to ADC and SBB, are as good as assembly; unrolling
+// by four keeps the loop overhead off the chain.
+
+__attribute__(( target( "adx" ) ))
+BigNumDigit DigitsAddMulxAdx(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB )
+{
+	unsigned char ucCarry = 0;
+	int i;
+
+	for( i = 0; i + 4 <= nB; i += 4 )
+	{
+		ucCarry = _addcarryx_u64( ucCarry, pA[i], pB[i], &pDst[i] );
+		ucCarry = _addcarryx_u64( ucCarry, pA[i + 1], pB[i + 1], &pDst[i + 1] );
+		ucCarry = _addcarryx_u64( ucCarry, pA[i + 2], pB[i + 2], &pDst[i + 2] );
+		ucCarry = _addcarryx_u64( ucCarry, pA[i + 3], pB[i + 3], &pDst[i + 3] );
+	}
+
+	for( ; i < nB; ++i )
+	{
+		ucCarry = _addcarryx_u64( ucCarry, pA[i], pB[i], &pDst[i] );
+	}
+
+	for( ; i < nA; ++i )
+	{
+		ucCarry = _addcarryx_u64( ucCarry, pA[i], 0, &pDst[i] );
+	}
+
+	return( ucCarry );
+}
+
+
+BigNumDigit DigitsSubtractMulxAdx(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB )
+{
+	unsigned char ucBorrow = 0;
+	int i;
+
+	for( i = 0; i + 4 <= nB; i += 4 )
+	{
+		ucBorrow = _subborrow_u64( ucBorrow, pA[i], pB[i], &pDst[i] );
+		ucBorrow = _subborrow_u64( ucBorrow, pA[i + 1], pB[i + 1], &pDst[i + 1] );
+		ucBorrow = _subborrow_u64( ucBorrow, pA[i + 2], pB[i + 2], &pDst[i + 2] );
+		ucBorrow = _subborrow_u64( ucBorrow, pA[i + 3], pB[i + 3], &pDst[i + 3] );
+	}
+
+	for( ; i < nB; ++i )
+	{
+		ucBorrow = _subborrow_u64( ucBorrow, pA[i], pB[i], &pDst[i] );
+	}
+
+	for( ; i < nA; ++i )
+	{
+		ucBorrow = _subborrow_u64( ucBorrow, pA[i], 0, &pDst[i] );
+	}
+
+	return( ucBorrow );
+}
+
+
+BigNumDigit DigitsMultiplyAddMulxAdx(
+	BigNumDigit * pDst, const BigNumDigit * pSrc, int nSrc, BigNumDigit ullFactor )
+{
+	return( MultiplyAddRow( pDst, pSrc, nSrc, ullFactor ) );
+}
+
+
+// The same algorithm as the portable version: one row per digit of pT,
+// with the row's carry and the running carry added in one ADC.
+
+__attribute__(( target( "adx" ) ))
+void DigitsMontgomeryReduceMulxAdx(
+	BigNumDigit * pDst, BigNumDigit * pT,
+	const BigNumDigit * pN, int n, BigNumDigit ullNInverse )
+{
+	unsigned char ucCarry = 0;
+	int i;
+
+	for( i = 0; i < n; ++i )
+	{
+		const BigNumDigit kullProductCarry = MultiplyAddRow( pT + i, pN, n, pT[i] * ullNInverse );
+
+		ucCarry = _addcarryx_u64( ucCarry, pT[i + n], kullProductCarry, &pT[i + n] );
+	}
+
+	// The result is less than 2N, so at most one subtraction is needed.
+
+	if( ucCarry != 0  ||  DigitsCompare( pT + n, pN, n ) >= 0 )
+	{
+		DigitsSubtractMulxAdx( pDst, pT + n, n, pN, n );
+	}
+	else if( pDst != pT + n )
+	{
+		memcpy( pDst, pT + n, n * sizeof( BigNumDigit ) );
+	}
+}
+
+#endif // _HELIX_X86_64_KERNELS_
+
+
+// **** End of File ****
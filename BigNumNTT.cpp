@@ -0,0 +1,364 @@
+// BigNumNTT.cpp - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// Multiplication by number-theoretic transforms (NTTs).
+
+// Each digit of the operands becomes one coefficient of a polynomial.
+// The product's coefficients are computed modulo three 62-bit primes
+// of the form c * 2^32 + 1, and recombined exactly with the
+// Chinese Remainder Theorem.  A coefficient is at most
+// min( nA, nB ) * ( 2^64 - 1 )^2, which is far below the product
+// of the three primes (about 2^186).
+
+#include "Common.h"
+
+
+class CNTTPrime
+{
+public:
+	BigNumDigit m_ullP;
+	BigNumDigit m_ullPInverse;	// -1 / p mod 2^64, for Montgomery reduction.
+	BigNumDigit m_ullR2;		// 2^128 mod p.
+	BigNumDigit m_ullGenerator;	// A primitive root mod p.
+
+	CNTTPrime( BigNumDigit ullP, BigNumDigit ullGenerator );
+
+	// Returns a value congruent to a * b / 2^64 mod p, in the range [0, 2p).
+	// a * b must be less than p * 2^64; since p < 2^62, a < 4p and b < p will do.
+
+	inline BigNumDigit MontgomeryMultiplyLazy( BigNumDigit a, BigNumDigit b ) const
+	{
+		const BigNumDoubleDigit kddProduct = (BigNumDoubleDigit)a * b;
+		const BigNumDigit kullM = (BigNumDigit)kddProduct * m_ullPInverse;
+
+		return( (BigNumDigit)( ( kddProduct + (BigNumDoubleDigit)kullM * m_ullP ) >> knBitsPerDigit ) );
+	}
+
+	// Returns a * b / 2^64 mod p.  Both arguments must be less than p.
+
+	inline BigNumDigit MontgomeryMultiply( BigNumDigit a, BigNumDigit b ) const
+	{
+		const BigNumDigit kullResult = MontgomeryMultiplyLazy( a, b );
+
+		return( ( kullResult >= m_ullP ) ? kullResult - m_ullP : kullResult );
+	}
+
+	inline BigNumDigit ToMontgomery( BigNumDigit a ) const
+	{
+		return( MontgomeryMultiply( a, m_ullR2 ) );
+	}
+
+	// Plain modular arithmetic, for setup and recombination.
+
+	inline BigNumDigit MultiplyMod( BigNumDigit a, BigNumDigit b ) const
+	{
+		return( (BigNumDigit)( (BigNumDoubleDigit)a * b % m_ullP ) );
+	}
+
+	BigNumDigit PowerMod( BigNumDigit a, BigNumDigit e ) const;
+}; // class CNTTPrime
+
+
+CNTTPrime::CNTTPrime( BigNumDigit ullP, BigNumDigit ullGenerator )
+	: m_ullP( ullP ),
+		m_ullPInverse( 0 ),
+		m_ullR2( 0 ),
+		m_ullGenerator( ullGenerator )
+{
+	// Newton's iteration for 1 / p mod 2^64; each step doubles the correct bits.
+	BigNumDigit ullInverse = ullP;
+	int i;
+
+	for( i = 0; i < 6; ++i )
+	{
+		ullInverse *= 2 - ullP * ullInverse;
+	}
+
+	m_ullPInverse = -ullInverse;
+
+	const BigNumDigit kullR = (BigNumDigit)( ( (BigNumDoubleDigit)1 << knBitsPerDigit ) % ullP );
+
+	m_ullR2 = MultiplyMod( kullR, kullR );
+}
+
+
+BigNumDigit CNTTPrime::PowerMod( BigNumDigit a, BigNumDigit e ) const
+{
+	// Work in Montgomery form, and convert back at the end.
+	BigNumDigit ullResult = ToMontgomery( 1 );
+
+	a = ToMontgomery( a % m_ullP );
+
+	while( e > 0 )
+	{
+
+		if( ( e & 1 ) != 0 )
+		{
+			ullResult = MontgomeryMultiply( ullResult, a );
+		}
+
+		a = MontgomeryMultiply( a, a );
+		e >>= 1;
+	}
+
+	return( MontgomeryMultiply( ullResult, 1 ) );
+}
+
+
+static const CNTTPrime kaNTTPrimes[3] =
+{
+	CNTTPrime( 0x3FFFFFEE00000001ULL, 3 ),
+	CNTTPrime( 0x3FFFFFB400000001ULL, 19 ),
+	CNTTPrime( 0x3FFFFFA000000001ULL, 3 )
+};
+
+// Each prime is c * 2^32 + 1, so transforms of up to 2^32 points are possible.
+static const int knMaxNTTLog = 32;
+
+
+// Fills pTwiddles with w^j in Montgomery form, for j < nCount.
+
+static void NTTMakeTwiddles(
+	BigNumDigit * pTwiddles, int nCount, BigNumDigit ullRoot, const CNTTPrime & prime )
+{
+	const BigNumDigit kullMontRoot = prime.ToMontgomery( ullRoot );
+	int j;
+
+	pTwiddles[0] = prime.ToMontgomery( 1 );
+
+	for( j = 1; j < nCount; ++j )
+	{
+		pTwiddles[j] = prime.MontgomeryMultiply( pTwiddles[j - 1], kullMontRoot );
+	}
+}
+
+
+// In-place transform of 2^nLog values, each less than 4p.
+// pTwiddles is from NTTMakeTwiddles() with 2^( nLog - 1 ) powers of a
+// primitive 2^nLog-th root of unity (or of its inverse).
+// Harvey's lazy butterflies keep values in [0, 4p) until the end,
+// when they are fully reduced; since p < 2^62, 4p fits in a digit.
+
+static void NTTTransform(
+	BigNumDigit * pA, int nLog,
+	const BigNumDigit * pTwiddles, const CNTTPrime & prime )
+{
+	const int knLength = 1 << nLog;
+	const BigNumDigit kullP = prime.m_ullP;
+	const BigNumDigit kullTwoP = 2 * kullP;
+	int i;
+	int j;
+
+	// Bit-reversal permutation.
+
+	for( i = 1, j = 0; i < knLength; ++i )
+	{
+		int nBit = knLength >> 1;
+
+		for( ; ( j & nBit ) != 0; nBit >>= 1 )
+		{
+			j ^= nBit;
+		}
+
+		j ^= nBit;
+
+		if( i < j )
+		{
+			const BigNumDigit kullTemp = pA[i];
+
+			pA[i] = pA[j];
+			pA[j] = kullTemp;
+		}
+	}
+
+	int nHalf;
+
+	for( nHalf = 1; nHalf < knLength; nHalf <<= 1 )
+	{
+		const int knStride = knLength / ( 2 * nHalf );
+
+		for( i = 0; i < knLength; i += 2 * nHalf )
+		{
+			BigNumDigit * pX = pA + i;
+			BigNumDigit * pY = pX + nHalf;
+
+			for( j = 0; j < nHalf; ++j )
+			{
+				const BigNumDigit kullX = ( pX[j] >= kullTwoP ) ? pX[j] - kullTwoP : pX[j];
+				const BigNumDigit kullT = prime.MontgomeryMultiplyLazy( pY[j], pTwiddles[j * knStride] );
+
+				pX[j] = kullX + kullT;
+				pY[j] = kullX - kullT + kullTwoP;
+			}
+		}
+	}
+
+	for( i = 0; i < knLength; ++i )
+	{
+		BigNumDigit ullX = pA[i];
+
+		ullX = ( ullX >= kullTwoP ) ? ullX - kullTwoP : ullX;
+		pA[i] = ( ullX >= kullP ) ? ullX - kullP : ullX;
+	}
+}
+
+
+// Computes the cyclic convolution of pA and pB modulo one prime.
+// pResult receives 2^nLog residues; pWork and pTwiddles are work space.
+
+static void NTTConvolve(
+	BigNumDigit * pResult, BigNumDigit * pWork, BigNumDigit * pTwiddles,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB,
+	int nLog, const CNTTPrime & prime )
+{
+	const int knLength = 1 << nLog;
+	const BigNumDigit kullP = prime.m_ullP;
+	const BigNumDigit kullFourP = 4 * kullP;
+	int i;
+
+	// The transform accepts values below 4p, and 2^64 < 5p.
+
+	for( i = 0; i < knLength; ++i )
+	{
+		pResult[i] = ( i >= nA ) ? 0 : ( pA[i] >= kullFourP ) ? pA[i] - kullFourP : pA[i];
+	}
+
+	// When squaring, one forward transform serves for both operands.
+	const bool kbSquaring = pA == pB  &&  nA == nB;
+
+	if( !kbSquaring )
+	{
+
+		for( i = 0; i < knLength; ++i )
+		{
+			pWork[i] = ( i >= nB ) ? 0 : ( pB[i] >= kullFourP ) ? pB[i] - kullFourP : pB[i];
+		}
+	}
+
+	// Forward transforms.
+	const BigNumDigit kullRoot = prime.PowerMod( prime.m_ullGenerator, ( kullP - 1 ) >> nLog );
+
+	NTTMakeTwiddles( pTwiddles, knLength / 2, kullRoot, prime );
+	NTTTransform( pResult, nLog, pTwiddles, prime );
+
+	if( kbSquaring )
+	{
+		pWork = pResult;
+	}
+	else
+	{
+		NTTTransform( pWork, nLog, pTwiddles, prime );
+	}
+
+	// Pointwise products.  Each carries a stray factor of 1 / 2^64,
+	// which the final scaling removes.
+
+	for( i = 0; i < knLength; ++i )
+	{
+		pResult[i] = prime.MontgomeryMultiply( pResult[i], pWork[i] );
+	}
+
+	// Inverse transform, with the inverse root.
+	NTTMakeTwiddles( pTwiddles, knLength / 2, prime.PowerMod( kullRoot, kullP - 2 ), prime );
+	NTTTransform( pResult, nLog, pTwiddles, prime );
+
+	// Scale by 2^64 / 2^nLog: MontgomeryMultiply( x, 2^128 / 2^nLog ) does that.
+	const BigNumDigit kullInverseLength = prime.PowerMod( (BigNumDigit)knLength, kullP - 2 );
+	const BigNumDigit kullScale = prime.MultiplyMod( kullInverseLength, prime.m_ullR2 );
+
+	for( i = 0; i < knLength; ++i )
+	{
+		pResult[i] = prime.MontgomeryMultiply( pResult[i], kullScale );
+	}
+}
+
+
+void DigitsMultiplyNTT(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB )
+{
+	const int knProductSize = nA + nB;
+	int nLog = 0;
+
+	while( ( 1 << nLog ) < knProductSize )
+	{
+		++nLog;
+	}
+
+	if( nLog > knMaxNTTLog - 1 )
+	{
+		ThrowException();
+	}
+
+	const int knLength = 1 << nLog;
+	CBigNumArenaScope scope;
+	BigNumDigit * pResidues = scope.Allocate<BigNumDigit>( 3 * knLength );
+	BigNumDigit * pWork = scope.Allocate<BigNumDigit>( knLength );
+	BigNumDigit * pTwiddles = scope.Allocate<BigNumDigit>( knLength / 2 );
+	BigNumDigit * apResidues[3];
+	int i;
+
+	for( i = 0; i < 3; ++i )
+	{
+		apResidues[i] = pResidues + i * knLength;
+		NTTConvolve( apResidues[i], pWork, pTwiddles, pA, nA, pB, nB, nLog, kaNTTPrimes[i] );
+	}
+
+	// Garner's algorithm: x = r0 + p0 * ( t1 + p1 * t2 ), with each t < its prime.
+	// The constants are in Montgomery form, so that MontgomeryMultiply()
+	// by one of them is a plain modular multiplication.
+	const CNTTPrime & kP0 = kaNTTPrimes[0];
+	const CNTTPrime & kP1 = kaNTTPrimes[1];
+	const CNTTPrime & kP2 = kaNTTPrimes[2];
+	const BigNumDigit kullP0ModP2 = kP0.m_ullP % kP2.m_ullP;
+	const BigNumDigit kullP0P1ModP2 = kP2.MultiplyMod( kullP0ModP2, kP1.m_ullP % kP2.m_ullP );
+	const BigNumDigit kullMontP0InverseModP1 = kP1.ToMontgomery( kP1.PowerMod( kP0.m_ullP % kP1.m_ullP, kP1.m_ullP - 2 ) );
+	const BigNumDigit kullMontP0P1InverseModP2 = kP2.ToMontgomery( kP2.PowerMod( kullP0P1ModP2, kP2.m_ullP - 2 ) );
+	const BigNumDigit kullMontP0ModP2 = kP2.ToMontgomery( kullP0ModP2 );
+	const BigNumDoubleDigit kddP0P1 = (BigNumDoubleDigit)kP0.m_ullP * kP1.m_ullP;
+	const BigNumDigit kullP0P1Low = (BigNumDigit)kddP0P1;
+	const BigNumDigit kullP0P1High = (BigNumDigit)( kddP0P1 >> knBitsPerDigit );
+	BigNumDigit ullCarryLow = 0;
+	BigNumDigit ullCarryHigh = 0;
+
+	for( i = 0; i < knProductSize; ++i )
+	{
+		// Every prime is less than 2^62, and they are close together,
+		// so one conditional subtraction reduces a residue modulo another prime.
+		const BigNumDigit kullR0 = apResidues[0][i];
+		const BigNumDigit kullR1 = apResidues[1][i];
+		const BigNumDigit kullR2 = apResidues[2][i];
+		const BigNumDigit kullR0ModP1 = ( kullR0 >= kP1.m_ullP ) ? kullR0 - kP1.m_ullP : kullR0;
+		const BigNumDigit kullT1 = kP1.MontgomeryMultiply(
+			( kullR1 >= kullR0ModP1 ) ? kullR1 - kullR0ModP1 : kullR1 + kP1.m_ullP - kullR0ModP1,
+			kullMontP0InverseModP1 );
+
+		// x01 = r0 + p0 * t1 < p0 * p1 < 2^124.
+		const BigNumDoubleDigit kddX01 = kullR0 + (BigNumDoubleDigit)kP0.m_ullP * kullT1;
+		const BigNumDigit kullR0ModP2 = ( kullR0 >= kP2.m_ullP ) ? kullR0 - kP2.m_ullP : kullR0;
+		const BigNumDigit kullT1ModP2 = ( kullT1 >= kP2.m_ullP ) ? kullT1 - kP2.m_ullP : kullT1;
+		BigNumDigit ullX01ModP2 = kullR0ModP2 + kP2.MontgomeryMultiply( kullT1ModP2, kullMontP0ModP2 );
+
+		ullX01ModP2 = ( ullX01ModP2 >= kP2.m_ullP ) ? ullX01ModP2 - kP2.m_ullP : ullX01ModP2;
+
+		const BigNumDigit kullT2 = kP2.MontgomeryMultiply(
+			( kullR2 >= ullX01ModP2 ) ? kullR2 - ullX01ModP2 : kullR2 + kP2.m_ullP - ullX01ModP2,
+			kullMontP0P1InverseModP2 );
+
+		// x = x01 + p0 * p1 * t2, as three digits; then add the running carry.
+		const BigNumDoubleDigit kddLow = (BigNumDoubleDigit)kullP0P1Low * kullT2;
+		const BigNumDoubleDigit kddHigh = (BigNumDoubleDigit)kullP0P1High * kullT2 + (BigNumDigit)( kddLow >> knBitsPerDigit );
+		BigNumDoubleDigit ddSum = (BigNumDoubleDigit)(BigNumDigit)kddLow + (BigNumDigit)kddX01 + ullCarryLow;
+
+		pDst[i] = (BigNumDigit)ddSum;
+		ddSum = ( ddSum >> knBitsPerDigit ) + (BigNumDigit)kddHigh + (BigNumDigit)( kddX01 >> knBitsPerDigit ) + ullCarryHigh;
+		ullCarryLow = (BigNumDigit)ddSum;
+		ullCarryHigh = (BigNumDigit)( ddSum >> knBitsPerDigit ) + (BigNumDigit)( kddHigh >> knBitsPerDigit );
+	}
+}
+
+
+// **** End of File ****
@@ -0,0 +1,218 @@
+// BigNumView.cpp - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+#include "Common.h"
+
+
+BigNumView::BigNumView( BigNumDigit * pDigits, int nCapacity, int nSize )
+	: m_pDigits( pDigits ),
+		m_nCapacity( nCapacity ),
+		m_nSize( nSize )
+{
+	CheckCapacity( nSize );
+	DiscardLeadingZeros();
+}
+
+
+void BigNumView::CheckCapacity( int nDigits ) const
+{
+
+	if( nDigits > m_nCapacity )
+	{
+		ThrowHelixException( "A BigNumView's capacity was exceeded." );
+	}
+}
+
+
+void BigNumView::DiscardLeadingZeros( void )
+{
+
+	while( m_nSize > 0  &&  m_pDigits[m_nSize - 1] == 0 )
+	{
+		--m_nSize;
+	}
+}
+
+
+int BigNumView::NumSignificantBits( void ) const
+{
+
+	if( m_nSize == 0 )
+	{
+		return( 0 );
+	}
+
+	return( m_nSize * knBitsPerDigit - __builtin_clzll( m_pDigits[m_nSize - 1] ) );
+}
+
+
+#ifdef BIG_ENDIAN
+// Converts digits to or from the order of a file's bytes, in place; the conversion
+// is its own inverse.  Either way, the segments are least significant first;
+// encrypted blocks hold little-endian segments (bSwapSegments), and raw data
+// native ones, as earlier versions read and wrote them.
+
+static void ReorderDigitBytes( BigNumDigit * pDigits, int nDigits, bool bSwapSegments )
+{
+	int i;
+	int j;
+
+	for( i = 0; i < nDigits; ++i )
+	{
+		unsigned short * pusSegments = (unsigned short *)&pDigits[i];
+
+		for( j = 0; j < knSegmentsPerDigit / 2; ++j )
+		{
+			const unsigned short kusSegment = pusSegments[j];
+
+			pusSegments[j] = pusSegments[knSegmentsPerDigit - 1 - j];
+			pusSegments[knSegmentsPerDigit - 1 - j] = kusSegment;
+		}
+
+		if( bSwapSegments )
+		{
+
+			for( j = 0; j < knSegmentsPerDigit; ++j )
+			{
+				ByteSwapUnsignedShort( pusSegments[j] );
+			}
+		}
+	}
+}
+#endif
+
+
+unsigned short BigNumView::ReadFromFile( FILE * srcFile, int nReadSize )
+{
+	unsigned char * pucDigits = (unsigned char *)m_pDigits;
+	bool bDataIsEncrypted = false;
+	unsigned short usBytesEncrypted = 0;
+
+	m_nSize = 0;
+
+	if( nReadSize <= 0 )
+	{
+		// We're reading encrypted data.
+		// The first UShort is the number of bytes of raw, unencrypted data represented in this BigNum.
+		// The second UShort is the number of segments (UShorts) in this BigNum.
+		unsigned short usReadSize = 0;
+		unsigned char acHeaderBuf[4];
+		const size_t unNumItemsRead = fread( acHeaderBuf, sizeof( unsigned char ), 4, srcFile );
+
+		if( unNumItemsRead == 0  &&  feof( srcFile ) )
+		{
+			// End of source file.
+			return( 0 );
+		}
+		else if( unNumItemsRead != 4 )
+		{
+			Signal();
+			ThrowException(  );
+		}
+
+		usBytesEncrypted = *(unsigned short *)acHeaderBuf;
+		usReadSize = *(unsigned short *)( acHeaderBuf + 2 );
+
+#ifdef BIG_ENDIAN
+		ByteSwapUnsignedShort( usBytesEncrypted );
+		ByteSwapUnsignedShort( usReadSize );
+#endif
+
+		nReadSize = (int)usReadSize;
+		bDataIsEncrypted = true;
+	}
+
+	const size_t kunBytesToRead = sizeof( unsigned short ) * (size_t)nReadSize;
+
+	CheckCapacity( (int)( ( kunBytesToRead + sizeof( BigNumDigit ) - 1 ) / sizeof( BigNumDigit ) ) );
+
+	const size_t kunNumBytesRead = fread( pucDigits, sizeof( unsigned char ), kunBytesToRead, srcFile );
+
+	if( !bDataIsEncrypted )
+	{
+
+		if( kunNumBytesRead == 0  &&  feof( srcFile ) )
+		{
+			// End of source file.
+			return( 0 );
+		}
+
+		usBytesEncrypted = (unsigned short)kunNumBytesRead;
+	}
+
+	// Clear the rest of the last digit, so that it contains only the data just read
+	// (an odd byte count leaves a partial segment there, too).
+	const int knNumDigits = (int)( ( kunNumBytesRead + sizeof( BigNumDigit ) - 1 ) / sizeof( BigNumDigit ) );
+
+	memset( pucDigits + kunNumBytesRead, 0, knNumDigits * sizeof( BigNumDigit ) - kunNumBytesRead );
+
+#ifdef BIG_ENDIAN
+	ReorderDigitBytes( m_pDigits, knNumDigits, bDataIsEncrypted );
+#endif
+
+	m_nSize = knNumDigits;
+	DiscardLeadingZeros();
+	return( usBytesEncrypted );
+}
+
+
+void BigNumView::WriteToFile( FILE * dstFile, unsigned short usBytesEncrypted, size_t unBytesToWrite ) const
+{
+	const int knNumSegments = NumSegments();
+
+	if( usBytesEncrypted > 0 )
+	{
+		// We're writing encrypted data.
+		// The first UShort is the number of bytes of raw, unencrypted data represented in this BigNum.
+		// The second UShort is the number of segments (UShorts) in this BigNum.
+		unsigned short ausHeader[2];
+
+		ausHeader[0] = usBytesEncrypted;
+		ausHeader[1] = (unsigned short)knNumSegments;
+
+#ifdef BIG_ENDIAN
+		ByteSwapUnsignedShort( ausHeader[0] );
+		ByteSwapUnsignedShort( ausHeader[1] );
+#endif
+
+		if( fwrite( ausHeader, 1, sizeof( ausHeader ), dstFile ) != sizeof( ausHeader ) )
+		{
+			Signal();
+			ThrowException(  );
+		}
+	}
+
+	if( unBytesToWrite == 0 )
+	{
+		unBytesToWrite = knNumSegments * sizeof( unsigned short );
+	}
+
+	const int knNumDigits = (int)( ( unBytesToWrite + sizeof( BigNumDigit ) - 1 ) / sizeof( BigNumDigit ) );
+
+	CheckCapacity( knNumDigits );
+
+	if( knNumDigits > m_nSize )
+	{
+		memset( m_pDigits + m_nSize, 0, ( knNumDigits - m_nSize ) * sizeof( BigNumDigit ) );
+	}
+
+#ifdef BIG_ENDIAN
+	ReorderDigitBytes( m_pDigits, knNumDigits, usBytesEncrypted > 0 );
+#endif
+
+	const size_t kunNumBytesWritten = fwrite( m_pDigits, 1, unBytesToWrite, dstFile );
+
+#ifdef BIG_ENDIAN
+	ReorderDigitBytes( m_pDigits, knNumDigits, usBytesEncrypted > 0 );
+#endif
+
+	if( kunNumBytesWritten != unBytesToWrite )
+	{
+		Signal();
+		ThrowException(  );
+	}
+}
+
+
+// **** End of File ****
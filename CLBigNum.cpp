@@ -5,88 +5,510 @@
 // This file contains an implementation of a limited-size big number class.
 // This allows the buffer to be allocated as an array when the object is created,
 // so that the buffer is contiguous and doesn't need to grow.
+// The arithmetic is done by the digit kernels, in the factory's scratch space.
 
 // The CLBigNumFactory class allows CLBigNum objects to be reused,
 // instead of unnecessarily created and destroyed.
 
-// The CLBigNum class currently requires a little-endian architecture.
+#include "Common.h"
 
-#include <stack>
 
-#include "Common.h"
+CLBigNum::CLBigNum( CLBigNumFactory & factory )
+	: m_Factory( factory ),
+		m_a( new BigNumDigit[factory.GetCapacity()] ),
+		m_nSize( 0 )
+{
+}
 
-using std::stack;
 
+CLBigNum::~CLBigNum( void )
+{
+	delete [] m_a;
+}
 
-static const int knNumSegments = 1000;
 
-class CLBigNumFactory;
+CLBigNumFactory & CLBigNum::GetFactory( void )
+{
+	return( m_Factory );
+}
+
 
-class CLBigNum	// Limited-size big number.
+void CLBigNum::Reset( void )
 {
-private:
-	typedef unsigned long SegmentType;
+	m_nSize = 0;
+}
 
-	CLBigNumFactory & m_Factory;
-	SegmentType m_a[knNumSegments];
-	int m_nSize;	// Number of segments in use.
 
-public:
-	CLBigNum( CLBigNumFactory & factory );
-	CLBigNumFactory & GetFactory( void );	// Const or not const?
-	void Reset( void );
+void CLBigNum::CheckCapacity( int nDigits ) const
+{
 
-	// Insert other members here.
-}; // class CLBigNum
+	if( nDigits > m_Factory.GetCapacity() )
+	{
+		ThrowHelixException( "A CLBigNum's capacity was exceeded." );
+	}
+}
 
 
-CLBigNum::CLBigNum( CLBigNumFactory & factory )
-	: m_Factory( factory )
+void CLBigNum::DiscardLeadingZeros( void )
 {
-	Reset();
+
+	while( m_nSize > 0  &&  m_a[m_nSize - 1] == 0 )
+	{
+		--m_nSize;
+	}
 }
 
 
-CLBigNumFactory & CLBigNum::GetFactory( void )
+CLBigNum & CLBigNum::operator =( const CLBigNum & Src )
 {
-	return( m_Factory );
+
+	if( this != &Src )
+	{
+		CheckCapacity( Src.m_nSize );
+		memcpy( m_a, Src.m_a, Src.m_nSize * sizeof( BigNumDigit ) );
+		m_nSize = Src.m_nSize;
+	}
+
+	return( *this );
 }
 
 
-void CLBigNum::Reset( void )
+CLBigNum & CLBigNum::operator =( const BigNum & Src )
 {
-	memset( m_a, 0, knNumSegments * sizeof( SegmentType ) );
-	m_nSize = 0;
+	const int knDigits = Src.NumDigits();
+
+	CheckCapacity( knDigits );
+
+	if( knDigits > 0 )
+	{
+		memcpy( m_a, &Src.m_v[0], knDigits * sizeof( BigNumDigit ) );
+	}
+
+	m_nSize = knDigits;
+	return( *this );
 }
 
 
-class CLBigNumFactory
+void CLBigNum::ToBigNum( BigNum & dst ) const
 {
-private:
-	stack<CLBigNum *> m_stack;
+	dst.m_v.assign( m_a, m_a + m_nSize );
+}
 
-public:
-	CLBigNumFactory( void );
-	~CLBigNumFactory( void );	// Not virtual, so not part of a class heirarchy.
-	CLBigNum * Acquire( void );
-	void Release( CLBigNum * p );
-}; // class CLBigNumFactory
+
+int CLBigNum::NumSignificantBits( void ) const
+{
+
+	if( m_nSize == 0 )
+	{
+		return( 0 );
+	}
+
+	return( m_nSize * knBitsPerDigit - __builtin_clzll( m_a[m_nSize - 1] ) );
+}
 
 
-CLBigNumFactory::CLBigNumFactory( void )
+int CLBigNum::Compare( const CLBigNum & Src ) const
 {
+
+	if( m_nSize != Src.m_nSize )
+	{
+		return( ( m_nSize < Src.m_nSize ) ? -1 : 1 );
+	}
+
+	return( DigitsCompare( m_a, Src.m_a, m_nSize ) );
 }
 
 
-CLBigNumFactory::~CLBigNumFactory( void )
+int CLBigNum::Compare( const BigNum & Src ) const
 {
+	const int knSrcSize = Src.NumDigits();
 
-	while( !m_stack.empty() )
+	if( m_nSize != knSrcSize )
 	{
-		CLBigNum * p = m_stack.top();
+		return( ( m_nSize < knSrcSize ) ? -1 : 1 );
+	}
+
+	return( ( m_nSize > 0 ) ? DigitsCompare( m_a, &Src.m_v[0], m_nSize ) : 0 );
+}
+
 
-		m_stack.pop();
-		delete p;
+// The kernels allow their output to be their first operand, and only read
+// each digit of the second operand before writing the same digit of the output,
+// so either operand may be *this.
+
+void CLBigNum::Add( const CLBigNum & a, const CLBigNum & b )
+{
+	const CLBigNum & kLong = ( a.m_nSize >= b.m_nSize ) ? a : b;
+	const CLBigNum & kShort = ( a.m_nSize >= b.m_nSize ) ? b : a;
+	const int knDigits = kLong.m_nSize;
+	BigNumDigit ullCarry;
+
+	CheckCapacity( knDigits );
+	ullCarry = DigitsAdd( m_a, kLong.m_a, knDigits, kShort.m_a, kShort.m_nSize );
+	m_nSize = knDigits;
+
+	if( ullCarry != 0 )
+	{
+		CheckCapacity( knDigits + 1 );
+		m_a[m_nSize++] = ullCarry;
+	}
+}
+
+
+void CLBigNum::Subtract( const CLBigNum & a, const CLBigNum & b )
+{
+
+	if( a < b )
+	{
+		ThrowException();
+	}
+
+	CheckCapacity( a.m_nSize );
+	DigitsSubtract( m_a, a.m_a, a.m_nSize, b.m_a, b.m_nSize );
+	m_nSize = a.m_nSize;
+	DiscardLeadingZeros();
+}
+
+
+// When the shorter operand is big enough for the faster methods, the longer
+// one is multiplied in pieces the size of the shorter one, so that each piece
+// is a balanced product in the factory's scratch space, rather than one that
+// the DigitsMultiply() dispatcher would allocate scratch space for.
+
+void CLBigNum::Multiply( const CLBigNum & a, const CLBigNum & b )
+{
+	const CLBigNum & kLong = ( a.m_nSize >= b.m_nSize ) ? a : b;
+	const CLBigNum & kShort = ( a.m_nSize >= b.m_nSize ) ? b : a;
+	const int knLong = kLong.m_nSize;
+	const int knShort = kShort.m_nSize;
+	const int knProduct = knLong + knShort;
+
+	if( knShort == 0 )
+	{
+		m_nSize = 0;
+		return;
+	}
+
+	CheckCapacity( knProduct );
+
+	const bool kbInPlace = ( this == &a  ||  this == &b );
+	BigNumDigit * pScratch = m_Factory.GetScratch(
+		knProduct + 3 * knShort + DigitsMultiplyScratchSize( knShort ) );
+	BigNumDigit * pProduct = kbInPlace ? pScratch : m_a;
+
+	if( knShort < knKaratsubaThreshold )
+	{
+		DigitsMultiplySchoolbook( pProduct, kLong.m_a, knLong, kShort.m_a, knShort );
+	}
+	else
+	{
+		BigNumDigit * pPieceProduct = pScratch + knProduct;
+		BigNumDigit * pPiece = pPieceProduct + 2 * knShort;
+		BigNumDigit * pKernelScratch = pPiece + knShort;
+		int nLow;
+
+		memset( pProduct, 0, knProduct * sizeof( BigNumDigit ) );
+
+		for( nLow = 0; nLow < knLong; nLow += knShort )
+		{
+			const int knPiece = ( knLong - nLow < knShort ) ? knLong - nLow : knShort;
+			const BigNumDigit * kpPiece = kLong.m_a + nLow;
+
+			// The last piece is padded with zeros; its product's top digits are zero.
+
+			if( knPiece < knShort )
+			{
+				memcpy( pPiece, kpPiece, knPiece * sizeof( BigNumDigit ) );
+				memset( pPiece + knPiece, 0, ( knShort - knPiece ) * sizeof( BigNumDigit ) );
+				kpPiece = pPiece;
+			}
+
+			DigitsMultiplyBalanced( pPieceProduct, kpPiece, kShort.m_a, knShort, pKernelScratch );
+			DigitsAdd( pProduct + nLow, pProduct + nLow, knProduct - nLow, pPieceProduct, knPiece + knShort );
+		}
+	}
+
+	if( kbInPlace )
+	{
+		memcpy( m_a, pProduct, knProduct * sizeof( BigNumDigit ) );
+	}
+
+	m_nSize = knProduct;
+	DiscardLeadingZeros();
+}
+
+
+// Multiply() squares when both operands are the same number.
+
+void CLBigNum::Square( const CLBigNum & a )
+{
+	Multiply( a, a );
+}
+
+
+void CLBigNum::DivideAndModulo(
+	const CLBigNum & dividend, const CLBigNum & divisor,
+	CLBigNum * pQuotient, CLBigNum * pRemainder )
+{
+	const int knU = dividend.m_nSize;
+	const int knV = divisor.m_nSize;
+
+	if( knV == 0 )
+	{
+		ThrowException();
+	}
+	else if( knU < knV )
+	{
+
+		if( pRemainder != 0 )
+		{
+			*pRemainder = dividend;
+		}
+
+		if( pQuotient != 0 )
+		{
+			pQuotient->m_nSize = 0;
+		}
+
+		return;
+	}
+
+	// The results are formed in scratch space, since they may be the operands.
+	BigNumDigit * pQ = dividend.m_Factory.GetScratch( knU + 1 );
+	BigNumDigit * pR = pQ + knU - knV + 1;
+
+	DigitsDivide( pQ, pR, dividend.m_a, knU, divisor.m_a, knV );
+
+	if( pRemainder != 0 )
+	{
+		pRemainder->CheckCapacity( knV );
+		memcpy( pRemainder->m_a, pR, knV * sizeof( BigNumDigit ) );
+		pRemainder->m_nSize = knV;
+		pRemainder->DiscardLeadingZeros();
+	}
+
+	if( pQuotient != 0 )
+	{
+		pQuotient->CheckCapacity( knU - knV + 1 );
+		memcpy( pQuotient->m_a, pQ, ( knU - knV + 1 ) * sizeof( BigNumDigit ) );
+		pQuotient->m_nSize = knU - knV + 1;
+		pQuotient->DiscardLeadingZeros();
+	}
+}
+
+
+CLBigNum & CLBigNum::operator <<=( int nShift )
+{
+
+	if( nShift == 0  ||  IsZero() )
+	{
+		return( *this );
+	}
+	else if( nShift < 0 )
+	{
+		return( *this >>= -nShift );
+	}
+
+	const int knMajorShift = nShift / knBitsPerDigit;
+	const int knMinorShift = nShift % knBitsPerDigit;
+	const int knDigits = m_nSize;
+	int i;
+
+	if( knMinorShift == 0 )
+	{
+		CheckCapacity( knDigits + knMajorShift );
+		memmove( m_a + knMajorShift, m_a, knDigits * sizeof( BigNumDigit ) );
+		m_nSize = knDigits + knMajorShift;
+	}
+	else
+	{
+		const BigNumDigit kullTop = m_a[knDigits - 1] >> ( knBitsPerDigit - knMinorShift );
+
+		CheckCapacity( knDigits + knMajorShift + ( ( kullTop != 0 ) ? 1 : 0 ) );
+
+		if( kullTop != 0 )
+		{
+			m_a[knDigits + knMajorShift] = kullTop;
+		}
+
+		for( i = knDigits - 1; i > 0; --i )
+		{
+			m_a[i + knMajorShift] = ( m_a[i] << knMinorShift ) | ( m_a[i - 1] >> ( knBitsPerDigit - knMinorShift ) );
+		}
+
+		m_a[knMajorShift] = m_a[0] << knMinorShift;
+		m_nSize = knDigits + knMajorShift + ( ( kullTop != 0 ) ? 1 : 0 );
+	}
+
+	memset( m_a, 0, knMajorShift * sizeof( BigNumDigit ) );
+	return( *this );
+}
+
+
+CLBigNum & CLBigNum::operator >>=( int nShift )
+{
+
+	if( nShift == 0 )
+	{
+		return( *this );
+	}
+	else if( nShift < 0 )
+	{
+		return( *this <<= -nShift );
+	}
+
+	const int knMajorShift = nShift / knBitsPerDigit;
+	const int knMinorShift = nShift % knBitsPerDigit;
+	const int knDigits = m_nSize - knMajorShift;
+	int i;
+
+	if( knDigits <= 0 )
+	{
+		m_nSize = 0;
+		return( *this );
+	}
+
+	if( knMinorShift == 0 )
+	{
+		memmove( m_a, m_a + knMajorShift, knDigits * sizeof( BigNumDigit ) );
+	}
+	else
+	{
+
+		for( i = 0; i + 1 < knDigits; ++i )
+		{
+			m_a[i] = ( m_a[i + knMajorShift] >> knMinorShift ) | ( m_a[i + knMajorShift + 1] << ( knBitsPerDigit - knMinorShift ) );
+		}
+
+		m_a[knDigits - 1] = m_a[m_nSize - 1] >> knMinorShift;
+	}
+
+	m_nSize = knDigits;
+	DiscardLeadingZeros();
+	return( *this );
+}
+
+
+// The modular functions below hand the digits to the Montgomery context,
+// which works on exactly mont.GetNumDigits() digits, in scratch space.
+
+void CLBigNum::Reduce( const CLBigNum & a, const CMontgomeryContext & mont )
+{
+	const int knDigits = mont.GetNumDigits();
+	BigNumDigit * pWork = m_Factory.GetScratch( knDigits + mont.GetDigitsWorkSize( BigNum() ) );
+
+	CheckCapacity( knDigits );
+	mont.ReduceDigits( pWork, a.m_a, a.m_nSize, pWork + knDigits );
+	memcpy( m_a, pWork, knDigits * sizeof( BigNumDigit ) );
+	m_nSize = knDigits;
+	DiscardLeadingZeros();
+}
+
+
+void CLBigNum::MultiplyMod( const CLBigNum & a, const CLBigNum & b, const CMontgomeryContext & mont )
+{
+	const int knDigits = mont.GetNumDigits();
+	BigNumDigit * pA = m_Factory.GetScratch( 2 * knDigits + mont.GetDigitsWorkSize( BigNum() ) );
+	BigNumDigit * pB = pA + knDigits;
+
+	Assert( a.m_nSize <= knDigits  &&  b.m_nSize <= knDigits );
+	CheckCapacity( knDigits );
+	memcpy( pA, a.m_a, a.m_nSize * sizeof( BigNumDigit ) );
+	memset( pA + a.m_nSize, 0, ( knDigits - a.m_nSize ) * sizeof( BigNumDigit ) );
+	memcpy( pB, b.m_a, b.m_nSize * sizeof( BigNumDigit ) );
+	memset( pB + b.m_nSize, 0, ( knDigits - b.m_nSize ) * sizeof( BigNumDigit ) );
+	mont.MultiplyModDigits( m_a, pA, pB, pB + knDigits );
+	m_nSize = knDigits;
+	DiscardLeadingZeros();
+}
+
+
+// a is reduced first, so it may be of any size.
+
+void CLBigNum::ExponentMod( const CLBigNum & a, const BigNum & b, const CMontgomeryContext & mont )
+{
+	const int knDigits = mont.GetNumDigits();
+	BigNumDigit * pWork = m_Factory.GetScratch( knDigits + mont.GetDigitsWorkSize( b ) );
+
+	CheckCapacity( knDigits );
+	mont.ReduceDigits( pWork, a.m_a, a.m_nSize, pWork + knDigits );
+	mont.ExponentModDigits( m_a, pWork, b, pWork + knDigits );
+	m_nSize = knDigits;
+	DiscardLeadingZeros();
+}
+
+
+// The blocks are reduced into the scratch space first, so that the
+// exponentiation can write straight into the destinations.
+
+void CLBigNum::ExponentMod(
+	CLBigNum * const * ppDst, const CLBigNum * const * ppA, int nBlocks,
+	const CAdditionChain & chain, const CMultiBufferMontgomery & mb )
+{
+	const CMontgomeryContext & kMont = mb.GetContext();
+	const int knDigits = kMont.GetNumDigits();
+	const int knReduceWorkSize = kMont.GetDigitsWorkSize( BigNum() );
+	const int knExponentWorkSize = mb.GetDigitsWorkSize( chain );
+	BigNumDigit * pInputs = ppDst[0]->m_Factory.GetScratch( nBlocks * knDigits +
+		( ( knReduceWorkSize > knExponentWorkSize ) ? knReduceWorkSize : knExponentWorkSize ) );
+	BigNumDigit * pWork = pInputs + nBlocks * knDigits;
+	const BigNumDigit * apInputs[knMultiBufferMaxLanes];
+	BigNumDigit * apOutputs[knMultiBufferMaxLanes];
+	int j;
+
+	Assert( nBlocks <= knMultiBufferMaxLanes );
+
+	for( j = 0; j < nBlocks; ++j )
+	{
+		ppDst[j]->CheckCapacity( knDigits );
+		kMont.ReduceDigits( pInputs + j * knDigits, ppA[j]->m_a, ppA[j]->m_nSize, pWork );
+		apInputs[j] = pInputs + j * knDigits;
+		apOutputs[j] = ppDst[j]->m_a;
+	}
+
+	mb.ExponentModDigits( apOutputs, apInputs, nBlocks, chain, pWork );
+
+	for( j = 0; j < nBlocks; ++j )
+	{
+		ppDst[j]->m_nSize = knDigits;
+		ppDst[j]->DiscardLeadingZeros();
+	}
+}
+
+
+// The file's bytes go straight into m_a, where the arithmetic will find them.
+
+unsigned short CLBigNum::ReadFromFile( FILE * srcFile, int nReadSize )
+{
+	BigNumView view( m_a, m_Factory.GetCapacity() );
+	const unsigned short kusBytesEncrypted = view.ReadFromFile( srcFile, nReadSize );
+
+	m_nSize = view.NumDigits();
+	return( kusBytesEncrypted );
+}
+
+
+void CLBigNum::WriteToFile( FILE * dstFile, unsigned short usBytesEncrypted, size_t unBytesToWrite ) const
+{
+	const BigNumView kView( m_a, m_Factory.GetCapacity(), m_nSize );
+
+	kView.WriteToFile( dstFile, usBytesEncrypted, unBytesToWrite );
+}
+
+
+CLBigNumFactory::CLBigNumFactory( int nCapacity )
+	: m_nCapacity( nCapacity )
+{
+}
+
+
+CLBigNumFactory::~CLBigNumFactory( void )
+{
+	int i;
+
+	for( i = 0; i < (int)m_vFree.size(); ++i )
+	{
+		delete m_vFree[i];
 	}
 }
 
@@ -95,10 +517,10 @@ CLBigNum * CLBigNumFactory::Acquire( void )
 {
 	CLBigNum * p = 0;
 
-	if( !m_stack.empty() )
+	if( !m_vFree.empty() )
 	{
-		p = m_stack.top();
-		m_stack.pop();
+		p = m_vFree.back();
+		m_vFree.pop_back();
 		p->Reset();
 	}
 	else
@@ -124,38 +546,20 @@ CLBigNum * CLBigNumFactory::Acquire( void )
 
 void CLBigNumFactory::Release( CLBigNum * p )
 {
-	m_stack.push( p );
+	m_vFree.push_back( p );
 }
 
 
-class CLBigNumPtr
+BigNumDigit * CLBigNumFactory::GetScratch( int nDigits )
 {
-private:
-	CLBigNum * m_ptr;
-
-public:
-
-	CLBigNumPtr( CLBigNumFactory & factory )
-		: m_ptr( factory.Acquire() )
-	{
-	}
-
-	~CLBigNumPtr( void )	// Not virtual, so not part of a class heirarchy.
-	{
-		m_ptr->GetFactory().Release( m_ptr );
-		m_ptr = 0;
-	}
 
-	inline CLBigNum & operator*( void )
+	if( nDigits > (int)m_vScratch.size() )
 	{
-		return( *m_ptr );
+		m_vScratch.resize( nDigits );
 	}
 
-	inline CLBigNum * operator->( void )
-	{
-		return( m_ptr );
-	}
-}; // class CLBigNumPtr
+	return( &m_vScratch[0] );
+}
 
 
 // **** End of File ****
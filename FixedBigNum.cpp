@@ -0,0 +1,152 @@
+// FixedBigNum.cpp - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// The fixed-width Montgomery product is the same algorithm as
+// DigitsMultiplyBalanced() followed by DigitsMontgomeryReduce(), with the
+// schoolbook method for the product: one row per digit of a, and one
+// reduction row per digit of the product's low half.  Each row is the
+// MULX/ADCX/ADOX row of BigNumKernelsX86.cpp, but since the row length is
+// a compile-time constant, the assembler writes out every column, and there
+// is nothing left of the loop but the straight-line code.
+
+// With portable C++ rows, a fixed width gains nothing over the general
+// kernels (the compiler's unrolled loop is no better than theirs),
+// so there are only MULX/ADX instantiations.
+
+#include "Common.h"
+
+#ifdef _HELIX_X86_64_KERNELS_
+
+#include <immintrin.h>
+
+
+// pDst[0 .. knDigits - 1] += pSrc[0 .. knDigits - 1] * ullFactor; returns the carry.
+// .rept repeats the column knDigits times, and .set steps the offset
+// of the digits by 8 each time.
+
+template <int knDigits>
+static inline BigNumDigit FixedMultiplyAddRow(
+	BigNumDigit * pDst, const BigNumDigit * pSrc, BigNumDigit ullFactor )
+{
+	BigNumDigit ullCarry;
+
+	__asm__ __volatile__(
+		"xorl %%eax, %%eax\n\t"				// Clears CF and OF too
+		".set .Lhelix_fixed_offset, 0\n\t"
+		".rept %c[digits]\n\t"
+		"mulxq .Lhelix_fixed_offset(%[src]), %%r8, %%r9\n\t"
+		"adcxq %%rax, %%r8\n\t"
+		"adoxq .Lhelix_fixed_offset(%[dst]), %%r8\n\t"
+		"movq %%r8, .Lhelix_fixed_offset(%[dst])\n\t"
+		"movq %%r9, %%rax\n\t"
+		".set .Lhelix_fixed_offset, .Lhelix_fixed_offset + 8\n\t"
+		".endr\n\t"
+		"movl $0, %%r8d\n\t"
+		"adcxq %%r8, %%rax\n\t"
+		"adoxq %%r8, %%rax\n\t"
+		: "=&a" ( ullCarry )
+		: [src] "r" ( pSrc ), [dst] "r" ( pDst ), [digits] "i" ( knDigits ), "d" ( ullFactor )
+		: "r8", "r9", "cc", "memory" );
+
+	return( ullCarry );
+}
+
+
+template <int knBits>
+void FixedBigNum<knBits>::MontgomeryMultiply(
+	const FixedBigNum & a, const FixedBigNum & b,
+	const FixedBigNum & n, BigNumDigit ullNInverse )
+{
+	BigNumDigit aullT[2 * knDigits];
+	unsigned char ucCarry = 0;
+	int i;
+
+	// The product.  Row i adds a[i] * b into aullT[i .. i + knDigits - 1],
+	// and its carry becomes aullT[i + knDigits], which no row has touched yet.
+	memset( aullT, 0, knDigits * sizeof( BigNumDigit ) );
+
+	for( i = 0; i < knDigits; ++i )
+	{
+		aullT[i + knDigits] = FixedMultiplyAddRow<knDigits>( aullT + i, b.m_aDigits, a.m_aDigits[i] );
+	}
+
+	// The reduction: the same as DigitsMontgomeryReduce().
+
+	for( i = 0; i < knDigits; ++i )
+	{
+		const BigNumDigit kullProductCarry = FixedMultiplyAddRow<knDigits>(
+			aullT + i, n.m_aDigits, aullT[i] * ullNInverse );
+
+		ucCarry = _addcarry_u64( ucCarry, aullT[i + knDigits], kullProductCarry,
+			(unsigned long long *)&aullT[i + knDigits] );
+	}
+
+	// The result is less than 2n, so at most one subtraction is needed.
+
+	if( ucCarry != 0  ||  DigitsCompare( aullT + knDigits, n.m_aDigits, knDigits ) >= 0 )
+	{
+		unsigned char ucBorrow = 0;
+
+		for( i = 0; i < knDigits; ++i )
+		{
+			ucBorrow = _subborrow_u64( ucBorrow, aullT[i + knDigits], n.m_aDigits[i],
+				(unsigned long long *)&m_aDigits[i] );
+		}
+	}
+	else
+	{
+		memcpy( m_aDigits, aullT + knDigits, knDigits * sizeof( BigNumDigit ) );
+	}
+}
+
+
+template <int knBits>
+void FixedBigNum<knBits>::MontgomeryMultiplyDigits(
+	BigNumDigit * pDst, const BigNumDigit * pA, const BigNumDigit * pB,
+	const BigNumDigit * pN, BigNumDigit ullNInverse )
+{
+	( (FixedBigNum *)pDst )->MontgomeryMultiply(
+		*(const FixedBigNum *)pA, *(const FixedBigNum *)pB,
+		*(const FixedBigNum *)pN, ullNInverse );
+}
+
+
+template class FixedBigNum<512>;
+template class FixedBigNum<1024>;
+template class FixedBigNum<2048>;
+
+#endif // _HELIX_X86_64_KERNELS_
+
+
+PFixedMontgomeryMultiply GetFixedMontgomeryMultiply( int nBits )
+{
+#ifdef _HELIX_X86_64_KERNELS_
+	// The width of a modulus is its digit count.
+	const int knWidth = ( ( nBits + knBitsPerDigit - 1 ) / knBitsPerDigit ) * knBitsPerDigit;
+
+	if( DigitsFastKernelsInUse() )
+	{
+
+		switch( knWidth )
+		{
+			case 512:
+				return( &FixedBigNum<512>::MontgomeryMultiplyDigits );
+
+			case 1024:
+				return( &FixedBigNum<1024>::MontgomeryMultiplyDigits );
+
+			case 2048:
+				return( &FixedBigNum<2048>::MontgomeryMultiplyDigits );
+
+			default:
+				break;
+		}
+	}
+#endif
+
+	return( 0 );
+}
+
+
+// **** End of File ****
@@ -85,14 +85,50 @@ LINK32=xilink6.exe
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=.\AdditionChain.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Arena.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Barrett.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\BatchGCD.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\BigNum.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\BigNumKernels.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\BigNumKernelsX86.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\BigNumNTT.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\BigNumView.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\CLBigNum.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\FixedBigNum.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Main.cpp
 
 !IF  "$(CFG)" == "Helix - Win32 Release"
@@ -106,6 +142,14 @@ SOURCE=.\Main.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\Montgomery.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\MultiBuffer.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\RSAKey.cpp
 # End Source File
 # Begin Source File
@@ -122,10 +166,38 @@ SOURCE=.\Version.cpp
 # PROP Default_Filter "h;hpp;hxx;hm;inl"
 # Begin Source File
 
+SOURCE=.\Include\AdditionChain.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Include\Arena.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Include\Barrett.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Include\BatchGCD.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Include\BigNum.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\Include\BigNumKernels.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Include\BigNumView.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Include\CLBigNum.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Include\Common.h
 # End Source File
 # Begin Source File
@@ -134,14 +206,30 @@ SOURCE=.\Include\Exception.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\Include\FixedBigNum.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Include\HelixApp.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\Include\Montgomery.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Include\MultiBuffer.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Include\RSAKey.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\Include\SmallVector.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Include\UUCode.h
 # End Source File
 # Begin Source File
@@ -0,0 +1,70 @@
+// AdditionChain.h - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// An addition chain for one fixed exponent b: the squarings and multiplications
+// that take a to a^b, worked out once so that every exponentiation with b
+// just replays them.  The chain is b's sliding windows (as in
+// CMontgomeryContext::ExponentModDigits()), with the window width that costs
+// b the fewest products, and a table of only the odd powers a^( 2j + 1 )
+// that the windows actually use.
+
+// A key's exponent never changes, so a CRSAKeyEngine makes the chains when it
+// is constructed.  For a small public exponent, this is where the time goes:
+// 65537 = 2^16 + 1 is sixteen squarings and one multiplication, with no
+// table and no a^2, where a window width chosen by the exponent's length alone
+// would build a table it hardly uses.
+
+
+#ifndef _ADDITIONCHAIN_H_
+#define _ADDITIONCHAIN_H_
+
+
+class CAdditionChain
+{
+private:
+	int m_nTableSize;		// a, a^3, ..., a^( 2 * m_nTableSize - 1 )
+	vector<int> m_vSteps;	// The first table entry, then knSquare or the entry to multiply by
+
+	static int MakeSteps( const BigNum & b, int nWidth, vector<int> & vSteps );
+	static int CountProducts( int nTableSize, const vector<int> & vSteps );
+
+public:
+	static const int knSquare = -1;
+
+	CAdditionChain( const BigNum & b );
+
+	// The number of odd powers of a that the chain uses; 0 if b is 0.
+
+	inline int GetTableSize( void ) const
+	{
+		return( m_nTableSize );
+	}
+
+	// Step 0 is the table entry that the result starts as; each later step
+	// either squares the result (knSquare) or multiplies it by the table entry j.
+	// There are no steps if b is 0, and the result is 1.
+
+	inline int GetNumSteps( void ) const
+	{
+		return( m_vSteps.size() );
+	}
+
+	inline int GetStep( int i ) const
+	{
+		return( m_vSteps[i] );
+	}
+
+	// The number of products: the table's, and then the steps'.
+
+	inline int GetNumProducts( void ) const
+	{
+		return( CountProducts( m_nTableSize, m_vSteps ) );
+	}
+}; // class CAdditionChain
+
+
+#endif // _ADDITIONCHAIN_H_
+
+
+// **** End of File ****
@@ -0,0 +1,188 @@
+// Arena.h - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// A monotonic arena for short-lived big-number storage.
+// Each thread has its own arena: a list of blocks, allocated from the heap
+// as needed and kept for the life of the thread.  Memory is handed out
+// by bumping a pointer, in multiples of a cache line, and is never freed
+// piece by piece; instead, a CBigNumArenaScope marks the arena when it is
+// constructed, and releases everything allocated since, all at once,
+// when it is destroyed.  Scopes nest like the stack frames that hold them.
+
+// A BigNum constructed inside a scope takes its storage from that scope
+// (see CArenaStorage below), so it must not outlive the scope: a function
+// that opens a scope must construct its results before it, and then
+// assign to them.  Nor may it be resized by another thread while the scope
+// is open, since scopes are told apart only within a thread.
+
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+
+static const size_t knArenaAlignment = 64;				// A cache line
+static const size_t knArenaBlockSize = 64 * 1024;		// The smallest block
+
+
+class CBigNumArenaScope;
+
+
+class CBigNumArena
+{
+	friend class CBigNumArenaScope;
+
+private:
+
+	class CBlock
+	{
+	public:
+		unsigned char * m_pMemory;		// As allocated
+		unsigned char * m_pStart;		// Aligned
+		size_t m_unSize;				// From m_pStart
+	};
+
+	vector<CBlock> m_vBlocks;
+	int m_nBlock;						// The block being allocated from
+	size_t m_unOffset;					// The offset into it
+	size_t m_unBytesInUse;
+	size_t m_unHighWaterMark;
+	unsigned long long m_ullLastGeneration;	// Of the most recent scope on this thread
+
+	CBigNumArena( void );
+
+	// Not copyable.
+	CBigNumArena( const CBigNumArena & Src );
+	CBigNumArena & operator =( const CBigNumArena & Src );
+
+	void * Allocate( size_t unBytes );
+
+public:
+	~CBigNumArena( void );	// Not virtual, so not part of a class heirarchy.
+
+	static CBigNumArena & GetForThisThread( void );
+
+	// The most memory that has been in use at once, counting alignment
+	// and the unused ends of blocks; one block of this size would be enough.
+
+	inline size_t GetHighWaterMark( void ) const
+	{
+		return( m_unHighWaterMark );
+	}
+
+	inline void ResetHighWaterMark( void )
+	{
+		m_unHighWaterMark = m_unBytesInUse;
+	}
+}; // class CBigNumArena
+
+
+class CBigNumArenaScope
+{
+private:
+	static thread_local CBigNumArenaScope * s_pCurrent;
+
+	CBigNumArena & m_arena;
+	CBigNumArenaScope * m_pParent;
+	unsigned long long m_ullGeneration;
+	int m_nBlock;
+	size_t m_unOffset;
+	size_t m_unBytesInUse;
+
+	// Not copyable.
+	CBigNumArenaScope( const CBigNumArenaScope & Src );
+	CBigNumArenaScope & operator =( const CBigNumArenaScope & Src );
+
+public:
+	CBigNumArenaScope( void );
+	~CBigNumArenaScope( void );	// Not virtual, so not part of a class heirarchy.
+
+	// The innermost scope on this thread, or 0 if there is none.
+
+	static inline CBigNumArenaScope * GetCurrent( void )
+	{
+		return( s_pCurrent );
+	}
+
+	// Each scope on a thread has a generation greater than that of every scope
+	// before it on the thread, so no two scopes ever share one, even if one
+	// takes the other's place on the stack.  This returns the innermost scope's
+	// generation, or 0 if there is no scope.
+
+	static inline unsigned long long GetCurrentGeneration( void )
+	{
+		return( ( s_pCurrent != 0 ) ? s_pCurrent->m_ullGeneration : 0 );
+	}
+
+	// Uninitialized space for unCount objects of a plain type.
+	// This must be the innermost scope.
+
+	void * AllocateBytes( size_t unBytes );
+
+	template <class T>
+	inline T * Allocate( size_t unCount )
+	{
+		return( (T *)AllocateBytes( unCount * sizeof( T ) ) );
+	}
+}; // class CBigNumArenaScope
+
+
+// A storage policy for CSmallVector (see SmallVector.h).
+// A vector constructed inside a scope takes its heap blocks from that scope's
+// arena, for as long as the scope is the innermost one; at other times,
+// and outside any scope, it uses the heap as usual.  A block from a scope is
+// only handed to a vector constructed in the same scope; otherwise, moves copy.
+// Scopes are identified by generation rather than by address, since a later
+// scope can be constructed at the address of one that has ended.
+
+template <class T>
+class CArenaStorage
+{
+private:
+	unsigned long long m_ullGeneration;	// The innermost scope's when the owner was constructed
+	bool m_bFromArena;					// Whether the owner's current block came from that scope
+
+public:
+	CArenaStorage( void )
+		: m_ullGeneration( CBigNumArenaScope::GetCurrentGeneration() ),
+			m_bFromArena( false )
+	{
+	}
+
+	T * Allocate( size_t unCount )
+	{
+		m_bFromArena = ( m_ullGeneration != 0  &&  m_ullGeneration == CBigNumArenaScope::GetCurrentGeneration() );
+
+		if( m_bFromArena )
+		{
+			return( CBigNumArenaScope::GetCurrent()->Allocate<T>( unCount ) );
+		}
+
+		return( new T[unCount] );
+	}
+
+	void Free( T * p )
+	{
+
+		if( !m_bFromArena )
+		{
+			delete [] p;
+		}
+	}
+
+	inline bool CanAdopt( const CArenaStorage & src ) const
+	{
+		return( !src.m_bFromArena  ||  src.m_ullGeneration == m_ullGeneration );
+	}
+
+	inline void Adopt( const CArenaStorage & src )
+	{
+		m_bFromArena = src.m_bFromArena;
+	}
+}; // class CArenaStorage
+
+
+#endif // _ARENA_H_
+
+
+// **** End of File ****
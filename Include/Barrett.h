@@ -0,0 +1,40 @@
+// Barrett.h - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// Barrett reduction modulo a fixed n.
+// With B = 2^64 and k the number of digits in n, the reducer holds
+// mu = floor( B^2k / n ); any a < B^2k can then be reduced modulo n
+// with two multiplications and at most two subtractions.
+// Unlike Montgomery multiplication, it works on ordinary numbers
+// and any modulus, so it suits one-off reductions of varying width.
+
+
+#ifndef _BARRETT_H_
+#define _BARRETT_H_
+
+
+class CBarrettReducer
+{
+private:
+	BigNum m_n;
+	int m_nDigits;
+	BigNum m_mu;
+
+public:
+	CBarrettReducer( const BigNum & n );
+
+	inline const BigNum & GetModulus( void ) const
+	{
+		return( m_n );
+	}
+
+	// Returns a mod n.  Numbers of more than 2k digits fall back to division.
+	BigNum Reduce( const BigNum & a ) const;
+}; // class CBarrettReducer
+
+
+#endif // _BARRETT_H_
+
+
+// **** End of File ****
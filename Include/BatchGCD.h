@@ -0,0 +1,36 @@
+// BatchGCD.h - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// Bernstein's batch GCD ("How to find smooth parts of integers", 2004):
+// for each of k moduli n[i], the GCD of n[i] and the product of all the others,
+// in time quasi-linear in the total size of the moduli, rather than the
+// k * ( k - 1 ) / 2 GCDs of trying every pair.
+
+// A product tree multiplies the moduli together in pairs, then the pairs
+// in pairs, and so on up to the product P of them all.  A remainder tree then
+// takes P back down the same tree, reducing it modulo the square of each node:
+// at a leaf, this leaves P mod n[i]^2.  Since P / n[i] is the product of the
+// others, gcd( n[i], ( P mod n[i]^2 ) / n[i] ) is the GCD that was wanted.
+
+// A divisor of 1 means that n[i] shares no prime with any other modulus;
+// one strictly between 1 and n[i] is a shared prime (or a product of them);
+// and n[i] itself means that every prime of n[i] is shared, as with
+// a duplicated modulus.  Only the moduli with divisors other than 1
+// then need to be compared pairwise, to find out which shares with which.
+
+
+#ifndef _BATCHGCD_H_
+#define _BATCHGCD_H_
+
+
+// vDivisors[i] = gcd( vModuli[i], the product of all the other moduli ).
+// The moduli must be positive.
+
+void BatchGCD( const vector<BigNum> & vModuli, vector<BigNum> & vDivisors );
+
+
+#endif // _BATCHGCD_H_
+
+
+// **** End of File ****
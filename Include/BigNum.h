@@ -49,15 +49,40 @@ static inline void IntelDebugInterrupt( void )
 #endif
 
 
+// A BigNum is stored as a little-endian sequence of 64-bit digits.
+// Products and carries are computed in 128-bit intermediates.
+// Files still store numbers as little-endian 16-bit segments,
+// so each digit holds knSegmentsPerDigit of those segments.
+
+typedef unsigned long long BigNumDigit;
+typedef unsigned __int128 BigNumDoubleDigit;
+
+static const int knBitsPerDigit = 64;
+static const int knBitsPerSegment = 16;
+static const int knSegmentsPerDigit = knBitsPerDigit / knBitsPerSegment;
+
+// Numbers of up to knInlineDigits digits (4096 bits; so, for example, the
+// double-width products of 2048-bit numbers) are stored inside the BigNum
+// itself; only larger ones allocate their digits from the heap.
+
+static const int knInlineDigits = 64;
+
+
+class CBarrettReducer;
+
+
 class BigNum
 {
+	friend class CMontgomeryContext;
+	friend class CBarrettReducer;
+	friend class CLBigNum;
+	friend class CMultiBufferMontgomery;
+
 private:
 
-#ifdef _BIGNUM_USE_DEQUE_
-	typedef deque<unsigned short> DigitContainerType;
-#else
-	typedef vector<unsigned short> DigitContainerType;
-#endif
+	// The digits must be contiguous so that the kernels can operate on them.
+	// Larger numbers take their digits from the arena inside a CBigNumArenaScope.
+	typedef CSmallVector<BigNumDigit, knInlineDigits, CArenaStorage<BigNumDigit> > DigitContainerType;
 
 	DigitContainerType m_v;
 
@@ -70,35 +95,73 @@ private:
 
 	void AddShifted( const BigNum & Src, int nLeftShift );
 	void SetBit( int nBit );
+	BigNumDigit GetBits( int nLowBit ) const;
+	void SetToCombination(
+		const BigNum & x, BigNumDigit ullX,
+		const BigNum & y, BigNumDigit ullY, bool bSubtract );
+	unsigned short GetSegment( int nSegment ) const;
+	void SetFromSegments( int nNumSegments, const unsigned short * pusSrc );
+	static void AppendDecimal(
+		const BigNum & x, const vector<BigNum> & vPowers, int k, int nWidth,
+		vector<char> & vcDst );
+	static void AppendDecimalChunks( const BigNum & x, int nWidth, vector<char> & vcDst );
+	static void SetFromDecimalChunks(
+		BigNum & x, const BigNumDigit * pChunks, int nChunks,
+		const vector<BigNum> & vPowers, int k );
 
 public:
 	BigNum( void );
 	BigNum( int nNumUShorts, const unsigned short * pusSrc );
 	BigNum( unsigned long ulSrc );
 
-	const BigNum MultiplyWithUShort( unsigned short us ) const;
-	const BigNum MultiplyMod( const BigNum & b, const BigNum & n ) const;
+	BigNum MultiplyWithDigit( BigNumDigit ullFactor ) const;
+	BigNum MultiplyMod( const BigNum & b, const BigNum & n ) const;
+	BigNum SquareMod( const BigNum & n ) const;
+	BigNum MultiplyMod( const BigNum & b, const CBarrettReducer & reducer ) const;
+	BigNum SquareMod( const CBarrettReducer & reducer ) const;
 	static void DivideAndModulo(
 		const BigNum & dividendParam, const BigNum & divisorParam,
 		BigNum * pQuotient, BigNum * pRemainder );
 
+	// d = gcd( a, b ).  If pX isn't null, *pX is set to the x with
+	// a * x == d (mod b) and 0 < x <= b / d (x is 1 if b is zero).
+	// If pY isn't null, *pY is set to the y >= 0 with d == a * x - b * y
+	// (0 if a or b is zero).
+	static void ExtendedGCD( const BigNum & a, const BigNum & b, BigNum & d, BigNum * pX, BigNum * pY );
+
+	// The operators return non-const values, so their results can be moved;
+	// + and - reuse the storage of an operand that is about to be discarded.
 	BigNum & operator +=( const BigNum & Src );
-	const BigNum operator +( const BigNum & Src ) const;
+	BigNum operator +( const BigNum & Src ) const &;
+	BigNum operator +( const BigNum & Src ) &&;
+	BigNum operator +( BigNum && Src ) const &;
+	BigNum operator +( BigNum && Src ) &&;
 	BigNum & operator -=( const BigNum & Src );
-	const BigNum operator -( const BigNum & Src ) const;
+	BigNum operator -( const BigNum & Src ) const &;
+	BigNum operator -( const BigNum & Src ) &&;
 	BigNum & operator *=( const BigNum & Src );
-	const BigNum operator *( const BigNum & Src ) const;
+	BigNum operator *( const BigNum & Src ) const;
 	BigNum & operator /=( const BigNum & Src );
-	const BigNum operator /( const BigNum & Src ) const;
+	BigNum operator /( const BigNum & Src ) const;
 	BigNum & operator %=( const BigNum & Src );
-	const BigNum operator %( const BigNum & Src ) const;
+	BigNum operator %( const BigNum & Src ) const;
+	BigNum & operator %=( const CBarrettReducer & reducer );
+	BigNum operator %( const CBarrettReducer & reducer ) const;
 #if 0
-	const BigNum operator >>( int nShift ) const;
-	const BigNum operator <<( int nShift ) const;
+	BigNum operator >>( int nShift ) const;
+	BigNum operator <<( int nShift ) const;
 #endif
 	BigNum & ShiftRightBy1( void );
 	BigNum & operator >>=( int nShift );
 	BigNum & operator <<=( int nShift );
+
+	// Fused operations, which need no temporary BigNums:
+	// *this += a * b, *this -= a * b, *this += a * ullFactor, and *this -= a * ullFactor.
+	// A subtraction must not make *this negative.  a or b may be *this.
+	BigNum & AddProduct( const BigNum & a, const BigNum & b );
+	BigNum & SubtractProduct( const BigNum & a, const BigNum & b );
+	BigNum & AddMultiple( const BigNum & a, BigNumDigit ullFactor );
+	BigNum & SubtractMultiple( const BigNum & a, BigNumDigit ullFactor );
 	bool operator ==( const BigNum & Src ) const;
 
 	inline bool operator !=( const BigNum & Src ) const
@@ -128,45 +191,56 @@ public:
 		return( m_v.size() == 0 );
 	}
 
-	inline int NumSegments( void ) const
+	inline int NumDigits( void ) const
 	{
 		return( m_v.size() );
 	}
 
+	// The number of 16-bit segments; this is the unit used in files.
+
+	inline int NumSegments( void ) const
+	{
+		return( ( NumSignificantBits() + knBitsPerSegment - 1 ) / knBitsPerSegment );
+	}
+
 	int NumSignificantBits( void ) const;
 	bool TestBit( int nBit ) const;
 	void SetToRandom( int nBitLength );
 	void SetToRandomPrime( int nPrimeBitLength, int nWhichPrime = 0 );
 	void PrintDecimal( void ) const;
 	void PrintHex( void ) const;
+
+	// Text in base 10 or 16 (upper case), with no sign and no leading zeros:
+	// "0" for zero.  vcDst is set to the characters, followed by a null.
+	void ToString( vector<char> & vcDst, int nBase = 10 ) const;
+
+	// Parses text in base 10 or 16 (either case): digits only, at least one.
+	// Returns false, and sets *this to zero, if pcSrc isn't a number in that base.
+	bool FromString( const char * pcSrc, int nBase = 10 );
+
 	void HashWithString( const char * pcString );
 
 	void ReadFromFile( FILE * srcFile );
 	void WriteToFile( FILE * dstFile ) const;
-
-	unsigned short ReadFromFile( FILE * srcFile, unsigned char * pucSrcBuf, int nReadSize );
-	void WriteToFile(
-		FILE * dstFile, unsigned char * pucBuf,
-		unsigned short usBytesEncrypted, size_t unBytesToWrite ) const;
 }; // class BigNum
 
 
 // Returns ( a ^ b ) mod c.
 
-const BigNum ExponentMod( const BigNum & a, const BigNum & b, const BigNum & c );
+BigNum ExponentMod( const BigNum & a, const BigNum & b, const BigNum & c );
 
 
-// From "Introduction to Algorithms", p. 812.
 // Given a and b, finds d, x, and y such that:
 // 1) d = gcd( a, b ), and
-// 2) d = a * x + b * y.
+// 2) d = a * x - b * y, with x >= 0 and y >= 0, if a and b are nonzero.
+// Note the sign: this is not the d = a * x + b * y of most texts.
 
 void ExtendedEuclid(
 	const BigNum & a, const BigNum & b,
 	BigNum & d, BigNum & x, BigNum & y );
 
 
-const BigNum GCD( const BigNum & a, const BigNum & b );
+BigNum GCD( const BigNum & a, const BigNum & b );
 
 
 // If possible, find x such that a * x == 1 (mod n).
@@ -174,7 +248,16 @@ const BigNum GCD( const BigNum & a, const BigNum & b );
 bool MultiplicativeInverse( const BigNum & a, const BigNum & n, BigNum & x );
 
 
-void GenerateRSAKeys( int nBitLength, BigNum & d, BigNum & e, BigNum & n );
+// n has exactly nBitLength bits, so that the standard key sizes get
+// the fixed-width products (see FixedBigNum.h).
+// n is the product of nNumPrimes primes, which are returned in vPrimes
+// for the private key's CRT components.  If bUseExponent65537 is true,
+// e is 65537, and no prime is 1 mod 65537; otherwise e is a random odd
+// number of at most 16 bits.
+
+void GenerateRSAKeys(
+	int nBitLength, int nNumPrimes, BigNum & d, BigNum & e, BigNum & n,
+	vector<BigNum> & vPrimes, bool bUseExponent65537 = false );
 
 
 void EncryptFile(
@@ -0,0 +1,242 @@
+// BigNumKernels.h - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// Low-level arithmetic on raw spans of digits.
+// Each span is little-endian: element 0 is the least significant digit.
+// The DigitsMultiply() dispatcher, the NTT and DigitsDivide() take their
+// work space from the thread's arena (see Arena.h), which only allocates
+// memory when it grows; none of the other functions allocate memory.
+// The multiplication functions square, computing each cross product once,
+// when they are passed the same span as both operands.
+
+
+#ifndef _BIGNUMKERNELS_H_
+#define _BIGNUMKERNELS_H_
+
+
+// Operands with at least knNTTThreshold digits are multiplied with NTTs,
+// those with at least knToom3Threshold digits with Toom-3,
+// those with at least knKaratsubaThreshold digits with Karatsuba,
+// and smaller ones with the schoolbook method.
+// The menu's multiplication benchmark shows where the crossovers fall.
+// The NTT's cost doubles at each power of 2 of the operand size, so below
+// a million bits it only beats Toom-3 just under those powers; from 16384
+// digits up it is ahead throughout.
+
+static const int knKaratsubaThreshold = 32;
+static const int knToom3Threshold = 512;
+static const int knNTTThreshold = 16384;
+
+// Divisors with at least knDivideRecursiveThreshold digits are divided
+// recursively (see DigitsDivide()); smaller ones with Knuth's Algorithm D.
+
+static const int knDivideRecursiveThreshold = 48;
+
+
+// On x86-64 processors with the BMI2 and ADX extensions, DigitsAdd(),
+// DigitsSubtract(), DigitsMultiplyAdd() and DigitsMontgomeryReduce() use
+// kernels that multiply with MULX and run two carry chains at once
+// with ADCX and ADOX (see BigNumKernelsX86.cpp); CPUID is checked at startup,
+// and everywhere else they use portable C++.  Everything else in this file
+// is built on those four, so it gets faster too.
+
+#if defined( __GNUC__ )  &&  defined( __x86_64__ )
+#define _HELIX_X86_64_KERNELS_	1
+#endif
+
+
+// Selects the MULX/ADX kernels, if bUseFast is true and the processor has them,
+// or else the portable ones; returns true if the MULX/ADX kernels are now in use.
+// This is done at startup; tests and benchmarks may call it again,
+// as long as no other thread is doing arithmetic at the time.
+
+bool DigitsUseFastKernels( bool bUseFast );
+
+
+// Whether the MULX/ADX kernels are in use.
+
+bool DigitsFastKernelsInUse( void );
+
+
+// The name of the kernels in use: "MULX/ADX" or "portable".
+
+const char * DigitsKernelsName( void );
+
+
+// pDst[0 .. nA - 1] = pA + pB, where nA >= nB.
+// pDst may be the same as pA.  Returns the carry.
+
+BigNumDigit DigitsAdd(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB );
+
+
+// pDst[0 .. nA - 1] = pA - pB, where nA >= nB.
+// pDst may be the same as pA.  Returns the borrow.
+
+BigNumDigit DigitsSubtract(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB );
+
+
+// Returns -1, 0 or 1 as pA[0 .. n - 1] is less than, equal to, or greater than pB.
+
+int DigitsCompare( const BigNumDigit * pA, const BigNumDigit * pB, int n );
+
+
+// pDst[0 .. nSrc - 1] += pSrc[0 .. nSrc - 1] * ullFactor.
+// Returns the carry out of the most significant digit.
+
+BigNumDigit DigitsMultiplyAdd(
+	BigNumDigit * pDst, const BigNumDigit * pSrc, int nSrc, BigNumDigit ullFactor );
+
+
+// pDst[0 .. nSrc - 1] -= pSrc[0 .. nSrc - 1] * ullFactor.
+// Returns the borrow out of the most significant digit.
+
+BigNumDigit DigitsMultiplySubtract(
+	BigNumDigit * pDst, const BigNumDigit * pSrc, int nSrc, BigNumDigit ullFactor );
+
+
+// pDst[0 .. nA + nB - 1] = pA * pB, using the schoolbook method.
+// pDst must not overlap either operand.
+
+void DigitsMultiplySchoolbook(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB );
+
+
+// pDst[0 .. 2n - 1] = pA[0 .. n - 1]^2, using the schoolbook method.
+// pDst must not overlap the operand.
+
+void DigitsSquareSchoolbook( BigNumDigit * pDst, const BigNumDigit * pA, int n );
+
+
+// The number of scratch digits needed by DigitsMultiplyKaratsuba( n ).
+
+int DigitsKaratsubaScratchSize( int n );
+
+
+// pDst[0 .. 2n - 1] = pA[0 .. n - 1] * pB[0 .. n - 1], using Karatsuba.
+// pScratch must hold DigitsKaratsubaScratchSize( n ) digits.
+// pDst must not overlap either operand or the scratch space.
+
+void DigitsMultiplyKaratsuba(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, const BigNumDigit * pB, int n,
+	BigNumDigit * pScratch );
+
+
+// The number of scratch digits needed by DigitsMultiplyToom3( n ).
+
+int DigitsToom3ScratchSize( int n );
+
+
+// pDst[0 .. 2n - 1] = pA[0 .. n - 1] * pB[0 .. n - 1], using Toom-3.
+// pScratch must hold DigitsToom3ScratchSize( n ) digits.
+// pDst must not overlap either operand or the scratch space.
+
+void DigitsMultiplyToom3(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, const BigNumDigit * pB, int n,
+	BigNumDigit * pScratch );
+
+
+// pDst[0 .. nA + nB - 1] = pA * pB, using number-theoretic transforms
+// modulo three primes.  This takes its work space from the thread's arena.
+// pDst must not overlap either operand.
+
+void DigitsMultiplyNTT(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB );
+
+
+// The number of scratch digits needed by DigitsMultiplyBalanced( n ).
+
+int DigitsMultiplyScratchSize( int n );
+
+
+// pDst[0 .. 2n - 1] = pA[0 .. n - 1] * pB[0 .. n - 1],
+// using the fastest method for the size.
+// pScratch must hold DigitsMultiplyScratchSize( n ) digits.
+
+void DigitsMultiplyBalanced(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, const BigNumDigit * pB, int n,
+	BigNumDigit * pScratch );
+
+
+// pDst[0 .. nA + nB - 1] = pA * pB, using the fastest method for the size.
+// pDst must not overlap either operand.
+
+void DigitsMultiply(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB );
+
+
+// pDst[0 .. 2n - 1] = pA[0 .. n - 1]^2, using the fastest method for the size.
+// pDst must not overlap the operand.
+
+void DigitsSquare( BigNumDigit * pDst, const BigNumDigit * pA, int n );
+
+
+// pDst[0 .. n - 1] = pT / B^n mod pN, where B = 2^64 (Montgomery reduction).
+// pT has 2n digits, is less than pN * B^n, and is destroyed.
+// pN must be odd, and ullNInverse must be -pN^-1 mod B.
+// pDst may be pT + n, but must not otherwise overlap pT.
+
+void DigitsMontgomeryReduce(
+	BigNumDigit * pDst, BigNumDigit * pT,
+	const BigNumDigit * pN, int n, BigNumDigit ullNInverse );
+
+
+// Division: pQuotient[0 .. nU - nV] = pU / pV, and pRemainder[0 .. nV - 1] = pU % pV,
+// where nU >= nV and pV[nV - 1] != 0.  Either output may be null.
+// Either output may be pU itself, but they must not otherwise overlap
+// an operand or each other.  This takes its work space from the thread's arena.
+// Large divisors take a divide-and-conquer path, whose cost is a small
+// multiple of the cost of multiplication.
+
+void DigitsDivide(
+	BigNumDigit * pQuotient, BigNumDigit * pRemainder,
+	const BigNumDigit * pU, int nU,
+	const BigNumDigit * pV, int nV );
+
+
+#ifdef _HELIX_X86_64_KERNELS_
+
+// The MULX/ADX kernels, with the same contracts as the functions above.
+// They must only be called if DigitsCPUHasMulxAdx() returns true.
+
+bool DigitsCPUHasMulxAdx( void );
+
+BigNumDigit DigitsAddMulxAdx(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB );
+
+BigNumDigit DigitsSubtractMulxAdx(
+	BigNumDigit * pDst,
+	const BigNumDigit * pA, int nA,
+	const BigNumDigit * pB, int nB );
+
+BigNumDigit DigitsMultiplyAddMulxAdx(
+	BigNumDigit * pDst, const BigNumDigit * pSrc, int nSrc, BigNumDigit ullFactor );
+
+void DigitsMontgomeryReduceMulxAdx(
+	BigNumDigit * pDst, BigNumDigit * pT,
+	const BigNumDigit * pN, int n, BigNumDigit ullNInverse );
+
+#endif // _HELIX_X86_64_KERNELS_
+
+
+#endif // _BIGNUMKERNELS_H_
+
+
+// **** End of File ****
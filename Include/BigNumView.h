@@ -0,0 +1,83 @@
+// BigNumView.h - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// A non-owning view of a number held in someone else's buffer of digits.
+// The digit kernels, and the Montgomery context's functions on raw digits,
+// take a view's GetDigits() and NumDigits() as they are.
+
+// A view also does the block I/O of file encryption and decryption.
+// The files hold each block as little-endian 16-bit segments, which on
+// a little-endian processor are byte for byte the block's little-endian
+// 64-bit digits; so a view reads a block straight into its digits and writes
+// it straight out of them, with no intermediate buffer and no copying.
+// (If BIG_ENDIAN is defined, the bytes of each digit are reversed in place.)
+
+
+#ifndef _BIGNUMVIEW_H_
+#define _BIGNUMVIEW_H_
+
+
+class BigNumView
+{
+private:
+	BigNumDigit * m_pDigits;
+	int m_nCapacity;		// Digits in the buffer
+	int m_nSize;			// Number of digits in use; the top one is nonzero.
+
+	void CheckCapacity( int nDigits ) const;
+	void DiscardLeadingZeros( void );
+
+public:
+	// A view of the number in pDigits[0 .. nSize - 1], in a buffer of nCapacity digits.
+	// Leading zeros are discarded.
+	BigNumView( BigNumDigit * pDigits, int nCapacity, int nSize = 0 );
+
+	inline BigNumDigit * GetDigits( void ) const
+	{
+		return( m_pDigits );
+	}
+
+	inline int GetCapacity( void ) const
+	{
+		return( m_nCapacity );
+	}
+
+	inline int NumDigits( void ) const
+	{
+		return( m_nSize );
+	}
+
+	inline bool IsZero( void ) const
+	{
+		return( m_nSize == 0 );
+	}
+
+	int NumSignificantBits( void ) const;
+
+	// The number of 16-bit segments; this is the unit used in files.
+
+	inline int NumSegments( void ) const
+	{
+		return( ( NumSignificantBits() + knBitsPerSegment - 1 ) / knBitsPerSegment );
+	}
+
+	// Reads one block of a file being encrypted (nReadSize > 0: up to nReadSize
+	// segments of raw data) or decrypted (nReadSize <= 0: a header, and then
+	// the segments it gives the number of) into the buffer, and views it.
+	// Returns the number of bytes of raw data that the block represents,
+	// or 0 at the end of the file.
+	unsigned short ReadFromFile( FILE * srcFile, int nReadSize );
+
+	// Writes the block: with a header if usBytesEncrypted isn't 0 (encryption),
+	// or else unBytesToWrite bytes of raw data (decryption).  The buffer's
+	// digits above NumDigits() are cleared, as far as the bytes written reach;
+	// the number itself is unchanged.
+	void WriteToFile( FILE * dstFile, unsigned short usBytesEncrypted, size_t unBytesToWrite ) const;
+}; // class BigNumView
+
+
+#endif // _BIGNUMVIEW_H_
+
+
+// **** End of File ****
@@ -0,0 +1,192 @@
+// CLBigNum.h - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// A limited-size big number.  Its digits are one array, allocated when the
+// object is created, so the buffer is contiguous and never needs to grow.
+// The capacity is set by the CLBigNumFactory that creates the number;
+// for RSA, it is sized to the key.
+
+// The CLBigNumFactory class allows CLBigNum objects to be reused,
+// instead of unnecessarily created and destroyed.  It also owns the scratch
+// space that the arithmetic works in, so once a factory has warmed up,
+// its numbers can be used without allocating any memory.
+// A factory and its numbers must only be used by one thread at a time.
+
+
+#ifndef _CLBIGNUM_H_
+#define _CLBIGNUM_H_
+
+
+class CLBigNumFactory;
+
+
+class CLBigNum	// Limited-size big number.
+{
+private:
+	CLBigNumFactory & m_Factory;
+	BigNumDigit * m_a;
+	int m_nSize;	// Number of digits in use; the top one is nonzero.
+
+	// Not copyable; use operator =.
+	CLBigNum( const CLBigNum & Src );
+
+	void CheckCapacity( int nDigits ) const;
+	void DiscardLeadingZeros( void );
+
+public:
+	CLBigNum( CLBigNumFactory & factory );
+	~CLBigNum( void );	// Not virtual, so not part of a class heirarchy.
+	CLBigNumFactory & GetFactory( void );
+	void Reset( void );
+
+	CLBigNum & operator =( const CLBigNum & Src );
+	CLBigNum & operator =( const BigNum & Src );
+	void ToBigNum( BigNum & dst ) const;
+
+	inline bool IsZero( void ) const
+	{
+		return( m_nSize == 0 );
+	}
+
+	inline int NumDigits( void ) const
+	{
+		return( m_nSize );
+	}
+
+	int NumSignificantBits( void ) const;
+
+	// The number of 16-bit segments; this is the unit used in files.
+
+	inline int NumSegments( void ) const
+	{
+		return( ( NumSignificantBits() + knBitsPerSegment - 1 ) / knBitsPerSegment );
+	}
+
+	// Returns -1, 0 or 1 as *this is less than, equal to, or greater than Src.
+	int Compare( const CLBigNum & Src ) const;
+	int Compare( const BigNum & Src ) const;
+
+	inline bool operator ==( const CLBigNum & Src ) const
+	{
+		return( Compare( Src ) == 0 );
+	}
+
+	inline bool operator <( const CLBigNum & Src ) const
+	{
+		return( Compare( Src ) < 0 );
+	}
+
+	inline bool operator <( const BigNum & Src ) const
+	{
+		return( Compare( Src ) < 0 );
+	}
+
+	inline bool operator >=( const CLBigNum & Src ) const
+	{
+		return( Compare( Src ) >= 0 );
+	}
+
+	// *this = a + b, a - b (a must be at least b), a * b, and a^2.
+	// a or b may be *this.
+	void Add( const CLBigNum & a, const CLBigNum & b );
+	void Subtract( const CLBigNum & a, const CLBigNum & b );
+	void Multiply( const CLBigNum & a, const CLBigNum & b );
+	void Square( const CLBigNum & a );
+
+	// Either output may be null, or one of the operands.
+	// The division kernel allocates its own work space.
+	static void DivideAndModulo(
+		const CLBigNum & dividend, const CLBigNum & divisor,
+		CLBigNum * pQuotient, CLBigNum * pRemainder );
+
+	CLBigNum & operator <<=( int nShift );
+	CLBigNum & operator >>=( int nShift );
+
+	// Arithmetic modulo the context's (odd) modulus n.
+	// a may be *this.  For MultiplyMod(), a and b must be less than n.
+	void Reduce( const CLBigNum & a, const CMontgomeryContext & mont );
+	void MultiplyMod( const CLBigNum & a, const CLBigNum & b, const CMontgomeryContext & mont );
+	void ExponentMod( const CLBigNum & a, const BigNum & b, const CMontgomeryContext & mont );
+
+	// ppDst[j] = ppA[j] ^ b mod n, for j < nBlocks (at most knMultiBufferMaxLanes),
+	// where b is the exponent that the chain was made for, as many at once as
+	// the processor allows.  Each ppA[j] may be of any size, and ppDst[j] may be
+	// ppA[j].  The ppDst[j] must all come from one factory.
+	static void ExponentMod(
+		CLBigNum * const * ppDst, const CLBigNum * const * ppA, int nBlocks,
+		const CAdditionChain & chain, const CMultiBufferMontgomery & mb );
+
+	// Block I/O for file encryption and decryption, straight into and out of
+	// the number's own digits: see BigNumView.h and CHelixApp::EncryptFile().
+	unsigned short ReadFromFile( FILE * srcFile, int nReadSize );
+	void WriteToFile( FILE * dstFile, unsigned short usBytesEncrypted, size_t unBytesToWrite ) const;
+}; // class CLBigNum
+
+
+class CLBigNumFactory
+{
+private:
+	int m_nCapacity;						// Digits per number
+	vector<CLBigNum *> m_vFree;
+	vector<BigNumDigit> m_vScratch;
+
+	// Not copyable.
+	CLBigNumFactory( const CLBigNumFactory & Src );
+	CLBigNumFactory & operator =( const CLBigNumFactory & Src );
+
+public:
+	CLBigNumFactory( int nCapacity );
+	~CLBigNumFactory( void );	// Not virtual, so not part of a class heirarchy.
+	CLBigNum * Acquire( void );
+	void Release( CLBigNum * p );
+
+	inline int GetCapacity( void ) const
+	{
+		return( m_nCapacity );
+	}
+
+	// Returns at least nDigits digits of scratch space, which is only valid
+	// until the next call.  It only allocates when it needs more than ever before.
+	BigNumDigit * GetScratch( int nDigits );
+}; // class CLBigNumFactory
+
+
+class CLBigNumPtr
+{
+private:
+	CLBigNum * m_ptr;
+
+	// Not copyable.
+	CLBigNumPtr( const CLBigNumPtr & Src );
+	CLBigNumPtr & operator =( const CLBigNumPtr & Src );
+
+public:
+
+	CLBigNumPtr( CLBigNumFactory & factory )
+		: m_ptr( factory.Acquire() )
+	{
+	}
+
+	~CLBigNumPtr( void )	// Not virtual, so not part of a class heirarchy.
+	{
+		m_ptr->GetFactory().Release( m_ptr );
+		m_ptr = 0;
+	}
+
+	inline CLBigNum & operator*( void )
+	{
+		return( *m_ptr );
+	}
+
+	inline CLBigNum * operator->( void )
+	{
+		return( m_ptr );
+	}
+}; // class CLBigNumPtr
+
+
+#endif // _CLBIGNUM_H_
+
+
+// **** End of File ****
@@ -26,7 +26,14 @@
 
 //#include <string>
 #include <vector>
+#include <iterator>
+#include <utility>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 // Using directives.
 
@@ -38,13 +45,28 @@ using std::endl;
 
 //using std::string;
 using std::vector;
+using std::thread;
+using std::mutex;
+using std::condition_variable;
+using std::unique_lock;
 
 #undef BIG_ENDIAN
 
 // Custom includes.
 #include "Exception.h"
 #include "Version.h"
+#include "SmallVector.h"
+#include "Arena.h"
 #include "BigNum.h"
+#include "BigNumView.h"
+#include "BigNumKernels.h"
+#include "FixedBigNum.h"
+#include "AdditionChain.h"
+#include "Montgomery.h"
+#include "MultiBuffer.h"
+#include "Barrett.h"
+#include "BatchGCD.h"
+#include "CLBigNum.h"
 #include "RSAKey.h"
 #include "UUCode.h"
 #include "HelixApp.h"
@@ -0,0 +1,63 @@
+// FixedBigNum.h - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// Fixed-width numbers for the standard key sizes.
+// A FixedBigNum<knBits> is knBits / 64 digits in a plain array: it is never
+// resized or normalized, and its digit count is a compile-time constant,
+// so every loop over its digits has a constant trip count.  Its Montgomery
+// product writes each row of the multiplication and the reduction out in full,
+// with no loop control and no branches on the size (see FixedBigNum.cpp).
+
+// CMontgomeryContext asks GetFixedMontgomeryMultiply() for the instantiation
+// that matches its modulus, and uses the general digit kernels when there is
+// none.  The instantiations are for moduli of 512, 1024 and 2048 bits: RSA moduli
+// of 1024 and 2048 bits, and the CRT halves of those and of 4096-bit moduli.
+// At 1536 bits and at 3072 and 4096, the unrolled product was measured to be
+// no faster than the general kernels' loops, so those widths use the loops.
+
+
+#ifndef _FIXEDBIGNUM_H_
+#define _FIXEDBIGNUM_H_
+
+
+// pDst = pA * pB / R mod pN, where R = 2^( 64 * n ), n is the number of digits
+// the function was made for, and pA and pB are less than pN.  pDst may be pA or pB.
+// ullNInverse must be -pN^-1 mod 2^64.
+
+typedef void (*PFixedMontgomeryMultiply)(
+	BigNumDigit * pDst, const BigNumDigit * pA, const BigNumDigit * pB,
+	const BigNumDigit * pN, BigNumDigit ullNInverse );
+
+
+template <int knBits>
+class FixedBigNum
+{
+public:
+	static const int knDigits = knBits / knBitsPerDigit;
+
+	BigNumDigit m_aDigits[knDigits];	// Little-endian, like BigNum's
+
+	// *this = a * b / R mod n, where R = 2^knBits.  *this may be a or b.
+	void MontgomeryMultiply(
+		const FixedBigNum & a, const FixedBigNum & b,
+		const FixedBigNum & n, BigNumDigit ullNInverse );
+
+	// MontgomeryMultiply() on spans of knDigits digits; a PFixedMontgomeryMultiply.
+	static void MontgomeryMultiplyDigits(
+		BigNumDigit * pDst, const BigNumDigit * pA, const BigNumDigit * pB,
+		const BigNumDigit * pN, BigNumDigit ullNInverse );
+}; // class FixedBigNum
+
+
+// The fixed-width Montgomery product for moduli of nBits significant bits,
+// or 0 if there isn't one for that size.  The instantiations use the MULX/ADX
+// instructions, so this also returns 0 unless DigitsUseFastKernels() has chosen them.
+
+PFixedMontgomeryMultiply GetFixedMontgomeryMultiply( int nBits );
+
+
+#endif // _FIXEDBIGNUM_H_
+
+
+// **** End of File ****
@@ -13,14 +13,10 @@ private:
 	const CVersion m_version;
 
 	bool FileExists( char * pFilename ) const;
-	bool TestKeys( const BigNum & d, const BigNum & e, const BigNum & n ) const;
+	bool TestKeys( const CHelixRSAKey & publicKey, const CHelixRSAKey & privateKey ) const;
 	void HashPrivateKey( BigNum & d, BigNum & n ) const;
-	void EncryptFile(
-		FILE * srcFile, FILE * dstFile,
-		const BigNum & exponent, const BigNum & n ) const;
-	void DecryptFile(
-		FILE * srcFile, FILE * dstFile,
-		const BigNum & exponent, const BigNum & n ) const;
+	void EncryptFile( FILE * srcFile, FILE * dstFile, const CHelixRSAKey & key ) const;
+	void DecryptFile( FILE * srcFile, FILE * dstFile, const CHelixRSAKey & key ) const;
 
 	// Command functions.
 	void CommandGenerateKeys( void ) const;
@@ -30,6 +26,8 @@ private:
 	void CommandChangeKeyPassword( void ) const;
 	void CommandUUEncodeFile( void ) const;
 	void CommandUUDecodeFile( void ) const;
+	void CommandBenchmarkMultiplication( void ) const;
+	void CommandAuditPublicKeys( void ) const;
 
 public:
 	CHelixApp( void );
@@ -0,0 +1,120 @@
+// Montgomery.h - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// Montgomery multiplication modulo a fixed odd n.
+// With R = 2^( 64 * k ), where n has k digits, a number a is held as
+// a * R mod n (its Montgomery form); the product of two such numbers
+// can then be reduced without any division.
+
+
+#ifndef _MONTGOMERY_H_
+#define _MONTGOMERY_H_
+
+
+class CMontgomeryContext
+{
+private:
+	BigNum m_n;
+	int m_nDigits;
+	BigNumDigit m_ullNInverse;				// -n^-1 mod 2^64
+	vector<BigNumDigit> m_vRSquared;		// R^2 mod n, padded to m_nDigits
+	vector<BigNumDigit> m_vOne;				// R mod n: 1 in Montgomery form
+	PFixedMontgomeryMultiply m_pfnFixedMultiply;	// 0 if n has no fixed-width instantiation
+
+public:
+	// If bUseFixedWidth is true, and there is a FixedBigNum instantiation
+	// for n's size (see FixedBigNum.h), the context's products use it.
+	CMontgomeryContext( const BigNum & n, bool bUseFixedWidth = true );
+
+	inline const BigNum & GetModulus( void ) const
+	{
+		return( m_n );
+	}
+
+	// Whether the context's products are FixedBigNum ones.
+
+	inline bool UsesFixedWidth( void ) const
+	{
+		return( m_pfnFixedMultiply != 0 );
+	}
+
+	// Conversions to and from Montgomery form.  a must be less than n.
+	BigNum ToMontgomery( const BigNum & a ) const;
+	BigNum FromMontgomery( const BigNum & a ) const;
+
+	// Products of numbers in Montgomery form, in Montgomery form.
+	BigNum Multiply( const BigNum & a, const BigNum & b ) const;
+	BigNum Square( const BigNum & a ) const;
+
+	// Returns ( a ^ b ) mod n.  Neither a nor the result is in Montgomery form.
+	BigNum ExponentMod( const BigNum & a, const BigNum & b ) const;
+
+	// The same operations on raw digits, for callers such as CLBigNum that
+	// manage their own storage.  Operands and results have GetNumDigits() digits
+	// and are not in Montgomery form.  pWork must hold GetDigitsWorkSize( b )
+	// digits, where b is the largest exponent to be used (any b will do for
+	// ReduceDigits() and MultiplyModDigits()).  None of these allocate memory.
+
+	inline int GetNumDigits( void ) const
+	{
+		return( m_nDigits );
+	}
+
+	int GetDigitsWorkSize( const BigNum & b ) const;
+	int GetDigitsWorkSize( const CAdditionChain & chain ) const;
+
+	// pDst = pA[0 .. nA - 1] mod n, for any nA.  pDst must not overlap pA.
+	void ReduceDigits(
+		BigNumDigit * pDst, const BigNumDigit * pA, int nA,
+		BigNumDigit * pWork ) const;
+
+	// pDst = pA * pB mod n, where pA and pB are less than n.
+	void MultiplyModDigits(
+		BigNumDigit * pDst, const BigNumDigit * pA, const BigNumDigit * pB,
+		BigNumDigit * pWork ) const;
+
+	// pDst = pA ^ b mod n, where pA is less than n.  pDst may be pA.
+	void ExponentModDigits(
+		BigNumDigit * pDst, const BigNumDigit * pA, const BigNum & b,
+		BigNumDigit * pWork ) const;
+
+	// The same, for the exponent that the chain was made for; pWork must hold
+	// GetDigitsWorkSize( chain ) digits.
+	void ExponentModDigits(
+		BigNumDigit * pDst, const BigNumDigit * pA, const CAdditionChain & chain,
+		BigNumDigit * pWork ) const;
+
+	// Montgomery form on raw digits, for loops that would otherwise convert
+	// to and from BigNums at every step, such as the Miller-Rabin test.
+	// pWork must hold GetWorkSize() digits.
+
+	int GetWorkSize( void ) const;
+
+	// Copies a, which must be less than n, into GetNumDigits() digits, and back.
+	void LoadDigits( BigNumDigit * pDst, const BigNum & a ) const;
+	void StoreDigits( BigNum & a, const BigNumDigit * pSrc ) const;
+
+	// R mod n: 1 in Montgomery form.
+
+	inline const BigNumDigit * GetOneDigits( void ) const
+	{
+		return( &m_vOne[0] );
+	}
+
+	// pDst = pA * R mod n, where pA is less than n.  pDst may be pA.
+	void ToMontgomeryDigits(
+		BigNumDigit * pDst, const BigNumDigit * pA,
+		BigNumDigit * pWork ) const;
+
+	// pDst = pA * pB / R mod n.  pDst may be the same as pA or pB.
+	void MultiplyDigits(
+		BigNumDigit * pDst, const BigNumDigit * pA, const BigNumDigit * pB,
+		BigNumDigit * pWork ) const;
+}; // class CMontgomeryContext
+
+
+#endif // _MONTGOMERY_H_
+
+
+// **** End of File ****
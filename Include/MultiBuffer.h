@@ -0,0 +1,92 @@
+// MultiBuffer.h - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// Multi-buffer modular exponentiation: several numbers raised to the same
+// power modulo the same odd n, side by side in the lanes of SIMD registers.
+// Since every lane follows the same exponent, they all take the same steps
+// at the same time, and no lane ever waits for another.
+
+// The numbers are held structure-of-arrays: limb i of lane j is element
+// i * nLanes + j, so one vector load fetches limb i of every lane.
+// With AVX-512 IFMA, there are 8 lanes of 52-bit limbs, multiplied with
+// VPMADD52LUQ and VPMADD52HUQ; with AVX2 (on processors without the MULX/ADX
+// digit kernels, which are as fast), 4 lanes of 28-bit limbs, multiplied
+// with VPMULUDQ.  Otherwise there is one lane, and the numbers are
+// exponentiated one at a time by the Montgomery context's own code.
+
+
+#ifndef _MULTIBUFFER_H_
+#define _MULTIBUFFER_H_
+
+
+static const int knMultiBufferMaxLanes = 8;
+
+
+class CMultiBufferKernel;
+
+
+class CMultiBufferMontgomery
+{
+private:
+	const CMontgomeryContext & m_mont;
+	const CMultiBufferKernel * m_pKernel;		// 0 for one lane at a time
+	int m_nLanes;
+	int m_nLimbs;
+	BigNumDigit m_ullNInverse;					// -n^-1 mod 2^( limb bits )
+	vector<BigNumDigit> m_vN;					// n, in every lane
+	vector<BigNumDigit> m_vRSquared;			// R^2 mod n, in every lane, for R = 2^( limb bits * m_nLimbs )
+	vector<BigNumDigit> m_vOne;					// 1, in every lane
+
+	// Not copyable.
+	CMultiBufferMontgomery( const CMultiBufferMontgomery & Src );
+	CMultiBufferMontgomery & operator =( const CMultiBufferMontgomery & Src );
+
+	void LoadLane( BigNumDigit * pDst, int nLane, const BigNumDigit * pSrc ) const;
+	void StoreLane( BigNumDigit * pDst, const BigNumDigit * pSrc, int nLane ) const;
+	void Multiply( BigNumDigit * pDst, const BigNumDigit * pA, const BigNumDigit * pB, BigNumDigit * pWork ) const;
+	void ExponentModLanes(
+		BigNumDigit * const * ppDst, const BigNumDigit * const * ppA, int nBlocks,
+		const CAdditionChain & chain, BigNumDigit * pWork ) const;
+
+public:
+	// If bUseSIMD is false, or the processor has neither AVX-512 IFMA nor AVX2,
+	// the numbers are done one at a time.  bForceAVX2 uses AVX2 even where
+	// IFMA or the MULX/ADX digit kernels would be chosen, so that it can be
+	// checked on processors that have them; without AVX2, it means one at a time.
+	CMultiBufferMontgomery( const CMontgomeryContext & mont, bool bUseSIMD = true, bool bForceAVX2 = false );
+
+	inline const CMontgomeryContext & GetContext( void ) const
+	{
+		return( m_mont );
+	}
+
+	// The number of blocks that are done at once: 8, 4, or 1.
+
+	inline int GetNumLanes( void ) const
+	{
+		return( m_nLanes );
+	}
+
+	// "AVX-512 IFMA", "AVX2", or "scalar".
+	const char * GetName( void ) const;
+
+	// The number of digits of work space that ExponentModDigits() needs
+	// for the chain.
+	int GetDigitsWorkSize( const CAdditionChain & chain ) const;
+
+	// ppDst[j] = ppA[j] ^ b mod n, for j < nBlocks, where b is the exponent that
+	// the chain was made for, and nBlocks is at most knMultiBufferMaxLanes.
+	// Each number has the context's GetNumDigits() digits, and each ppA[j] is
+	// less than n.  ppDst[j] may be ppA[j].  pWork must hold
+	// GetDigitsWorkSize( chain ) digits.  This does not allocate memory.
+	void ExponentModDigits(
+		BigNumDigit * const * ppDst, const BigNumDigit * const * ppA, int nBlocks,
+		const CAdditionChain & chain, BigNumDigit * pWork ) const;
+}; // class CMultiBufferMontgomery
+
+
+#endif // _MULTIBUFFER_H_
+
+
+// **** End of File ****
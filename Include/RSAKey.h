@@ -7,20 +7,50 @@
 #define _RSAKEY_H_
 
 
+// One of the additional primes of a multi-prime private key
+// (PKCS #1's OtherPrimeInfo): the prime r, d mod ( r - 1 ), and the
+// inverse mod r of the product of all the primes before it.
+
+class CRSAOtherPrime
+{
+public:
+	BigNum m_r;
+	BigNum m_d;
+	BigNum m_t;
+}; // class CRSAOtherPrime
+
+
 class CHelixRSAKey
 {
 private:
 	CVersion m_version;
 	bool m_bIsPrivate;
+	bool m_bHasCRT;
 	BigNum m_exponent;
 	BigNum m_n;
 
+	// The Chinese Remainder Theorem components of a private key,
+	// in PKCS #1 order: n = p * q * r3 * ..., dP = d mod ( p - 1 ),
+	// dQ = d mod ( q - 1 ), and qInv = q^-1 mod p; then any other primes.
+	BigNum m_p;
+	BigNum m_q;
+	BigNum m_dP;
+	BigNum m_dQ;
+	BigNum m_qInv;
+	vector<CRSAOtherPrime> m_vOtherPrimes;
+
+	static void GetPassword( char * pcPassword, int nBufferSize );
+	void HashPrivateNumbers( const char * pcPassword );
+
 public:
 	CHelixRSAKey( bool bIsPrivate, const CVersion & v, const BigNum & e, const BigNum & n );
+	CHelixRSAKey(
+		const CVersion & v, const BigNum & d, const BigNum & n,
+		const vector<BigNum> & vPrimes );
 	CHelixRSAKey( FILE * pSrcFile );
 	void WriteToFile( FILE * pDstFile ) const;
 	static void HashNumbers( BigNum & d, BigNum & n );
-	
+
 	inline const BigNum & GetExponent( void ) const
 	{
 		return( m_exponent );
@@ -30,9 +60,110 @@ public:
 	{
 		return( m_n );
 	}
+
+	inline bool IsPrivate( void ) const
+	{
+		return( m_bIsPrivate );
+	}
+
+	inline bool HasCRT( void ) const
+	{
+		return( m_bHasCRT );
+	}
+
+	inline const BigNum & GetP( void ) const
+	{
+		return( m_p );
+	}
+
+	inline const BigNum & GetQ( void ) const
+	{
+		return( m_q );
+	}
+
+	inline const BigNum & GetDP( void ) const
+	{
+		return( m_dP );
+	}
+
+	inline const BigNum & GetDQ( void ) const
+	{
+		return( m_dQ );
+	}
+
+	inline const BigNum & GetQInv( void ) const
+	{
+		return( m_qInv );
+	}
+
+	inline const vector<CRSAOtherPrime> & GetOtherPrimes( void ) const
+	{
+		return( m_vOtherPrimes );
+	}
 }; // class CHelixRSAKey
 
 
+// Applies a key to blocks: x^e mod n for a public key, x^d mod n for a private one.
+// The Montgomery contexts, the exponents' addition chains, and all the CLBigNums
+// are set up when the engine is constructed, so applying the key allocates no memory once the
+// factories' scratch space has grown to size on the first block.
+// Blocks are best applied GetBatchSize() at a time: they all share one
+// exponent, so a batch goes through the exponentiation side by side in
+// SIMD registers, where the processor has them (see MultiBuffer.h).
+// A private key with CRT components does one small exponentiation per prime
+// instead, each prime but q on a worker thread that lives as long as the engine,
+// and combines them with Garner's formula.
+
+class CRSAPrimeWorker;
+
+class CRSAKeyEngine
+{
+private:
+	const CHelixRSAKey & m_key;
+	vector<CMontgomeryContext> m_vContexts;		// n; or p, q, r3, ...
+	vector<CMultiBufferMontgomery *> m_vMultiBuffers;	// One per context
+	vector<CAdditionChain> m_vChains;			// One per context: the exponent; or dP, dQ, d3, ...
+	CLBigNumFactory m_factory;
+
+	// Garner's constants, for p, r3, ...: each prime, its coefficient,
+	// and the product of the primes before it (q; q * p; ...).
+	vector<CLBigNum *> m_vPrimes;
+	vector<CLBigNum *> m_vCoefficients;
+	vector<CLBigNum *> m_vProducts;
+	vector<CRSAPrimeWorker *> m_vWorkers;		// p, r3, ...
+
+	// Not copyable.
+	CRSAKeyEngine( const CRSAKeyEngine & Src );
+	CRSAKeyEngine & operator =( const CRSAKeyEngine & Src );
+
+	CLBigNum * AcquireConstant( const BigNum & value );
+
+public:
+	CRSAKeyEngine( const CHelixRSAKey & key );
+	~CRSAKeyEngine( void );	// Not virtual, so not part of a class heirarchy.
+
+	// The blocks passed to Apply() should come from this factory.
+	inline CLBigNumFactory & GetFactory( void )
+	{
+		return( m_factory );
+	}
+
+	// The number of blocks that Apply() does at once: 8, 4, or 1.
+	inline int GetBatchSize( void ) const
+	{
+		return( m_vMultiBuffers[0]->GetNumLanes() );
+	}
+
+	// y = the key applied to x.  y must not be x.
+	void Apply( const CLBigNum & x, CLBigNum & y );
+	BigNum Apply( const BigNum & x );
+
+	// ppY[j] = the key applied to ppX[j], for j < nBlocks (at most knMultiBufferMaxLanes).
+	// No ppY[j] may be any of the ppX.
+	void Apply( const CLBigNum * const * ppX, CLBigNum * const * ppY, int nBlocks );
+}; // class CRSAKeyEngine
+
+
 #endif // _RSAKEY_H_
 
 
@@ -0,0 +1,365 @@
+// SmallVector.h - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// A vector that keeps up to N elements inside the object itself,
+// and only allocates from the heap when it grows beyond that.
+// It has the part of std::vector's interface that BigNum uses.
+// Elements are moved with memcpy() and never constructed or destroyed,
+// so T must be a plain type such as an integer.
+// Heap blocks come from a storage policy: by default, new and delete.
+
+
+#ifndef _SMALLVECTOR_H_
+#define _SMALLVECTOR_H_
+
+
+// A storage policy has Allocate() and Free() for the owner's heap blocks.
+// CanAdopt() says whether another owner's block may be handed to this one,
+// which then calls Adopt() to take over its bookkeeping.
+
+template <class T>
+class CHeapStorage
+{
+public:
+
+	inline T * Allocate( size_t unCount )
+	{
+		return( new T[unCount] );
+	}
+
+	inline void Free( T * p )
+	{
+		delete [] p;
+	}
+
+	inline bool CanAdopt( const CHeapStorage & src ) const
+	{
+		return( true );
+	}
+
+	inline void Adopt( const CHeapStorage & src )
+	{
+	}
+}; // class CHeapStorage
+
+
+template <class T, int N, class Storage = CHeapStorage<T> >
+class CSmallVector
+{
+public:
+	typedef T * iterator;
+	typedef const T * const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+private:
+	T * m_p;				// m_aInline, or a heap block
+	size_t m_unSize;
+	size_t m_unCapacity;
+	Storage m_storage;
+	T m_aInline[N];
+
+	inline bool IsInline( void ) const
+	{
+		return( m_p == m_aInline );
+	}
+
+	// Moves the elements to a heap block with room for at least unMinCapacity.
+
+	void Grow( size_t unMinCapacity )
+	{
+		size_t unCapacity = 2 * m_unCapacity;
+
+		if( unCapacity < unMinCapacity )
+		{
+			unCapacity = unMinCapacity;
+		}
+
+		Storage storage( m_storage );
+		T * p = storage.Allocate( unCapacity );
+
+		memcpy( p, m_p, m_unSize * sizeof( T ) );
+
+		if( !IsInline() )
+		{
+			m_storage.Free( m_p );
+		}
+
+		m_p = p;
+		m_unCapacity = unCapacity;
+		m_storage = storage;
+	}
+
+	// Takes src's elements, and its heap block if it has one that the storage
+	// policy lets this vector adopt; src is left empty.
+
+	void TakeFrom( CSmallVector & src )
+	{
+
+		if( src.IsInline()  ||  !m_storage.CanAdopt( src.m_storage ) )
+		{
+			assign( src.begin(), src.end() );
+		}
+		else
+		{
+
+			if( !IsInline() )
+			{
+				m_storage.Free( m_p );
+			}
+
+			m_storage.Adopt( src.m_storage );
+			m_p = src.m_p;
+			m_unSize = src.m_unSize;
+			m_unCapacity = src.m_unCapacity;
+			src.m_p = src.m_aInline;
+			src.m_unCapacity = N;
+		}
+
+		src.m_unSize = 0;
+	}
+
+public:
+	CSmallVector( void )
+		: m_p( m_aInline ),
+			m_unSize( 0 ),
+			m_unCapacity( N )
+	{
+	}
+
+	CSmallVector( const CSmallVector & src )
+		: m_p( m_aInline ),
+			m_unSize( 0 ),
+			m_unCapacity( N )
+	{
+		assign( src.begin(), src.end() );
+	}
+
+	CSmallVector( CSmallVector && src )
+		: m_p( m_aInline ),
+			m_unSize( 0 ),
+			m_unCapacity( N )
+	{
+		TakeFrom( src );
+	}
+
+	~CSmallVector( void )
+	{
+
+		if( !IsInline() )
+		{
+			m_storage.Free( m_p );
+		}
+	}
+
+	CSmallVector & operator =( const CSmallVector & src )
+	{
+
+		if( this != &src )
+		{
+			assign( src.begin(), src.end() );
+		}
+
+		return( *this );
+	}
+
+	CSmallVector & operator =( CSmallVector && src )
+	{
+
+		if( this != &src )
+		{
+			TakeFrom( src );
+		}
+
+		return( *this );
+	}
+
+	inline size_t size( void ) const
+	{
+		return( m_unSize );
+	}
+
+	inline bool empty( void ) const
+	{
+		return( m_unSize == 0 );
+	}
+
+	inline void clear( void )
+	{
+		m_unSize = 0;
+	}
+
+	inline void reserve( size_t unCapacity )
+	{
+
+		if( unCapacity > m_unCapacity )
+		{
+			Grow( unCapacity );
+		}
+	}
+
+	// As with std::vector, new elements are zero.
+
+	void resize( size_t unSize )
+	{
+		reserve( unSize );
+
+		if( unSize > m_unSize )
+		{
+			memset( m_p + m_unSize, 0, ( unSize - m_unSize ) * sizeof( T ) );
+		}
+
+		m_unSize = unSize;
+	}
+
+	void assign( size_t unSize, const T & value )
+	{
+		size_t i;
+
+		clear();
+		reserve( unSize );
+
+		for( i = 0; i < unSize; ++i )
+		{
+			m_p[i] = value;
+		}
+
+		m_unSize = unSize;
+	}
+
+	void assign( const T * pFirst, const T * pLast )
+	{
+		const size_t kunSize = pLast - pFirst;
+
+		clear();
+		reserve( kunSize );
+		memmove( m_p, pFirst, kunSize * sizeof( T ) );
+		m_unSize = kunSize;
+	}
+
+	inline void push_back( const T & value )
+	{
+
+		if( m_unSize == m_unCapacity )
+		{
+			Grow( m_unSize + 1 );
+		}
+
+		m_p[m_unSize++] = value;
+	}
+
+	inline void pop_back( void )
+	{
+		--m_unSize;
+	}
+
+	// Exchanges heap blocks when both vectors have one, and each may adopt
+	// the other's; otherwise copies.
+
+	void swap( CSmallVector & other )
+	{
+
+		if( !IsInline()  &&  !other.IsInline()  &&
+			m_storage.CanAdopt( other.m_storage )  &&  other.m_storage.CanAdopt( m_storage ) )
+		{
+			T * p = m_p;
+			const size_t kunSize = m_unSize;
+			const size_t kunCapacity = m_unCapacity;
+			const Storage kStorage( m_storage );
+
+			m_storage.Adopt( other.m_storage );
+			other.m_storage.Adopt( kStorage );
+
+			m_p = other.m_p;
+			m_unSize = other.m_unSize;
+			m_unCapacity = other.m_unCapacity;
+			other.m_p = p;
+			other.m_unSize = kunSize;
+			other.m_unCapacity = kunCapacity;
+		}
+		else
+		{
+			CSmallVector temp( std::move( *this ) );
+
+			TakeFrom( other );
+			other.TakeFrom( temp );
+		}
+	}
+
+	inline T & operator []( size_t i )
+	{
+		return( m_p[i] );
+	}
+
+	inline const T & operator []( size_t i ) const
+	{
+		return( m_p[i] );
+	}
+
+	inline T & front( void )
+	{
+		return( m_p[0] );
+	}
+
+	inline const T & front( void ) const
+	{
+		return( m_p[0] );
+	}
+
+	inline T & back( void )
+	{
+		return( m_p[m_unSize - 1] );
+	}
+
+	inline const T & back( void ) const
+	{
+		return( m_p[m_unSize - 1] );
+	}
+
+	inline iterator begin( void )
+	{
+		return( m_p );
+	}
+
+	inline const_iterator begin( void ) const
+	{
+		return( m_p );
+	}
+
+	inline iterator end( void )
+	{
+		return( m_p + m_unSize );
+	}
+
+	inline const_iterator end( void ) const
+	{
+		return( m_p + m_unSize );
+	}
+
+	inline reverse_iterator rbegin( void )
+	{
+		return( reverse_iterator( end() ) );
+	}
+
+	inline const_reverse_iterator rbegin( void ) const
+	{
+		return( const_reverse_iterator( end() ) );
+	}
+
+	inline reverse_iterator rend( void )
+	{
+		return( reverse_iterator( begin() ) );
+	}
+
+	inline const_reverse_iterator rend( void ) const
+	{
+		return( const_reverse_iterator( begin() ) );
+	}
+}; // class CSmallVector
+
+
+#endif // _SMALLVECTOR_H_
+
+
+// **** End of File ****
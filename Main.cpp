@@ -26,7 +26,44 @@
 // - Wrote an iterator-based subtraction function.
 
 // 0.2.0	?
-// - Switched from the BigNum class to the CLBigNum class to improve performance.
+// - Switched from the BigNum class to the CLBigNum class to improve performance:
+//   file encryption and decryption use pooled, fixed-capacity numbers sized to the key,
+//   and allocate no memory per block.
+// - BigNum digits are now 64 bits wide instead of 16; file formats are unchanged.
+// - BigNums of up to 4096 bits keep their digits inline instead of on the heap.
+// - BigNum results can be moved; in-place shifts, division and modulo; fused multiply-add.
+// - Karatsuba multiplication for numbers of 2048 bits and up.
+// - Toom-3 multiplication for numbers of 32768 bits and up.
+// - NTT multiplication (three primes, CRT) for numbers of 1048576 bits and up.
+// - Squaring computes each cross product once; ExponentMod and Miller-Rabin use it.
+// - Montgomery multiplication for modular exponentiation, primality tests and file encryption.
+// - Barrett reduction for even moduli and repeated reductions by one modulus.
+// - Division uses Knuth's Algorithm D instead of one bit at a time.
+// - Recursive (Burnikel-Ziegler) division for divisors of 3072 bits and up.
+// - Sliding window modular exponentiation.
+// - Iterative Lehmer extended GCD for GCD and MultiplicativeInverse (no more recursion).
+// - Private keys carry CRT components (p, q, dP, dQ, qInv); private-key operations
+//   do two half-size exponentiations, on two threads.
+// - Multi-prime keys (up to four primes) for faster private-key operations and key generation.
+// - A menu option to benchmark the multiplication methods.
+// - Scratch space and temporary BigNums come from a per-thread arena, released
+//   a scope at a time; key generation reports the arena's high-water mark.
+// - On x86-64 processors with BMI2 and ADX, the add, subtract, multiply-add
+//   and Montgomery reduction kernels use MULX, ADCX and ADOX, chosen at startup
+//   with CPUID; the portable kernels remain for everything else.
+// - File encryption and decryption exponentiate batches of blocks side by side
+//   in SIMD lanes: 8 with AVX-512 IFMA, or 4 with AVX2; one at a time otherwise.
+// - Fixed-width (FixedBigNum) Montgomery products for 512-, 1024- and 2048-bit
+//   moduli, fully unrolled, chosen by the modulus's size; Miller-Rabin works on raw digits.
+// - File blocks are read straight into the digits they are encrypted in, and written
+//   straight out of them (BigNumView), with no intermediate buffers or copies.
+// - BigNum::ToString() and FromString(): decimal and hexadecimal text, converted
+//   by divide and conquer for large numbers; PrintDecimal() prints the real value.
+// - Key generation can fix the public exponent at 65537.  Key engines precompute an
+//   addition chain per exponent (CAdditionChain), so 65537 costs 17 products a block.
+// - A command to audit many public keys for moduli that share primes, by batch GCD
+//   over product and remainder trees (BatchGCD()).  Divisions with quotients shorter
+//   than their divisors no longer cost a pass over the whole divisor per few digits.
 
 // **** END Release History ****
 
@@ -59,8 +96,11 @@ bool CHelixApp::FileExists( char * pFilename ) const
 }
 
 
-bool CHelixApp::TestKeys( const BigNum & d, const BigNum & e, const BigNum & n ) const
+bool CHelixApp::TestKeys( const CHelixRSAKey & publicKey, const CHelixRSAKey & privateKey ) const
 {
+	const BigNum & n = publicKey.GetN();
+	CRSAKeyEngine publicEngine( publicKey );
+	CRSAKeyEngine privateEngine( privateKey );
 
 	for( ; ; )
 	{
@@ -90,8 +130,8 @@ bool CHelixApp::TestKeys( const BigNum & d, const BigNum & e, const BigNum & n )
 
 		test.SetToRandom( n.NumSignificantBits() - 1 );
 
-		const BigNum testEncrypted = ExponentMod( test, e, n );
-		const BigNum testDecrypted = ExponentMod( testEncrypted, d, n );
+		const BigNum testEncrypted = publicEngine.Apply( test );
+		const BigNum testDecrypted = privateEngine.Apply( testEncrypted );
 
 		printf( "Original data:\n" );
 		test.PrintHex();
@@ -100,15 +140,36 @@ bool CHelixApp::TestKeys( const BigNum & d, const BigNum & e, const BigNum & n )
 		printf( "Decrypted:\n" );
 		testDecrypted.PrintHex();
 
-		if( testDecrypted == test )
+		if( testDecrypted != test )
 		{
-			printf( "Test succeeded!\n" );
+			printf( "Test failed.\n" );
+			return( false );
+		}
+
+		// Where n has a fixed width (see FixedBigNum.h), check its products
+		// against the general kernels'.
+		const CMontgomeryContext kFixed( n );
+
+		if( kFixed.UsesFixedWidth() )
+		{
+			const CMontgomeryContext kGeneral( n, false );
+
+			if( kFixed.ExponentMod( test, testEncrypted ) != kGeneral.ExponentMod( test, testEncrypted ) )
+			{
+				printf( "Test failed: the fixed-width products for the %d-bit modulus differ from the general ones.\n",
+					n.NumSignificantBits() );
+				return( false );
+			}
+
+			printf( "The %d-bit modulus uses fixed-width products, which agree with the general ones.\n",
+				n.NumSignificantBits() );
 		}
 		else
 		{
-			printf( "Test failed.\n" );
-			return( false );
+			printf( "The %d-bit modulus uses the general products.\n", n.NumSignificantBits() );
 		}
+
+		printf( "Test succeeded!\n" );
 	}
 
 	return( true );
@@ -124,15 +185,20 @@ void CHelixApp::HashPrivateKey( BigNum & d, BigNum & n ) const
 void CHelixApp::CommandGenerateKeys( void ) const
 {
 	int nBitLength = 0;
+	int nNumPrimes = 0;
+	char yn;
 	BigNum d;
 	BigNum e;
 	BigNum n;
+	vector<BigNum> vPrimes;
 	char acFileName[128];
 	char acFileName2[128];
 	FILE * dstFile = 0;
 	const int knMinBitLength = 128;
 	const int knAdvertisedMaxBitLength = 4096;
 	const int knActualMaxBitLength = 65536;
+	const int knMaxNumPrimes = 4;
+	const int knMinPrimeBitLength = 64;
 
 	// The number of segments in a BigNum must fit into an unsigned short,
 	// so the maximum size of a BigNum is 1048576 bits;
@@ -145,11 +211,41 @@ void CHelixApp::CommandGenerateKeys( void ) const
 	}
 	while( nBitLength < knMinBitLength  ||  nBitLength > knActualMaxBitLength );
 
+	// Multi-prime keys make private-key operations and key generation faster;
+	// each prime must still be reasonably large.
+	const int knMaxNumPrimesForLength = nBitLength / knMinPrimeBitLength < knMaxNumPrimes ?
+		nBitLength / knMinPrimeBitLength : knMaxNumPrimes;
+
+	do
+	{
+		printf( "Number of primes (2-%d) : ", knMaxNumPrimesForLength );
+		scanf( "%d", &nNumPrimes );
+	}
+	while( nNumPrimes < 2  ||  nNumPrimes > knMaxNumPrimesForLength );
+
+	// 65537 makes public-key operations about 17 products each; see AdditionChain.h.
+	printf( "Use 65537 as the public exponent? (y,n) : " );
+
+	do
+	{
+		// Eat any illegal input.
+		yn = getchar();
+	}
+	while( yn != 'y'  &&  yn != 'n' );
+
 	printf( "Generating keys...\n" );
-	GenerateRSAKeys( nBitLength, d, e, n );
+	GenerateRSAKeys( nBitLength, nNumPrimes, d, e, n, vPrimes, yn == 'y' );
 	printf( "Keys generated.\n" );
 
-	if( !TestKeys( d, e, n ) )
+	// The most scratch memory that the big-number arithmetic needed at once,
+	// for sizing the arena to the key length.
+	printf( "Arena high-water mark: %lu bytes.\n",
+		(unsigned long)CBigNumArena::GetForThisThread().GetHighWaterMark() );
+
+	const CHelixRSAKey kPubKey( false, m_version, e, n );
+	const CHelixRSAKey kPrvKey( m_version, d, n, vPrimes );
+
+	if( !TestKeys( kPubKey, kPrvKey ) )
 	{
 		return;
 	}
@@ -169,8 +265,6 @@ void CHelixApp::CommandGenerateKeys( void ) const
 		return;
 	}
 
-	const CHelixRSAKey kPubKey( false, m_version, e, n );
-
 	kPubKey.WriteToFile( dstFile );
 	fclose( dstFile );
 
@@ -185,8 +279,6 @@ void CHelixApp::CommandGenerateKeys( void ) const
 		return;
 	}
 
-	const CHelixRSAKey kPrvKey( true, m_version, d, n );
-
 	kPrvKey.WriteToFile( dstFile );
 	fclose( dstFile );
 }
@@ -250,7 +342,7 @@ void CHelixApp::CommandEncryptFile( void ) const
 		return;
 	}
 
-	EncryptFile( srcFile, dstFile, kKey.GetExponent(), kKey.GetN() );
+	EncryptFile( srcFile, dstFile, kKey );
 	fclose( dstFile );
 	fclose( srcFile );
 	printf( "Finished creating encrypted file '%s'\n", acFileName2 );
@@ -316,7 +408,7 @@ void CHelixApp::CommandDecryptFile( void ) const
 		return;
 	}
 
-	DecryptFile( srcFile, dstFile, kKey.GetExponent(), kKey.GetN() );
+	DecryptFile( srcFile, dstFile, kKey );
 	fclose( dstFile );
 	fclose( srcFile );
 	printf( "Finished creating decrypted file '%s'\n", acFileName2 );
@@ -542,6 +634,302 @@ void CHelixApp::CommandUUDecodeFile( void ) const
 }
 
 
+// Returns the average time in microseconds of one multiplication of two
+// n-digit numbers, using the given method: 0 for schoolbook,
+// 1 for Karatsuba, 2 for Toom-3, and 3 for NTT.
+
+static double TimeMultiplication(
+	int nMethod, int n,
+	const BigNumDigit * pA, const BigNumDigit * pB,
+	BigNumDigit * pProduct, BigNumDigit * pScratch )
+{
+	const clock_t kMinClocks = CLOCKS_PER_SEC / 4;
+	const clock_t kStart = clock();
+	clock_t elapsed = 0;
+	int nReps = 0;
+
+	do
+	{
+
+		switch( nMethod )
+		{
+			case 0:
+				DigitsMultiplySchoolbook( pProduct, pA, n, pB, n );
+				break;
+
+			case 1:
+				DigitsMultiplyKaratsuba( pProduct, pA, pB, n, pScratch );
+				break;
+
+			case 2:
+				DigitsMultiplyToom3( pProduct, pA, pB, n, pScratch );
+				break;
+
+			default:
+				DigitsMultiplyNTT( pProduct, pA, n, pB, n );
+				break;
+		}
+
+		++nReps;
+		elapsed = clock() - kStart;
+	}
+	while( elapsed < kMinClocks );
+
+	return( 1000000.0 * (double)elapsed / CLOCKS_PER_SEC / nReps );
+}
+
+
+// Returns the average time in microseconds of one modular exponentiation
+// with the context, of a full-size number to a full-size power.
+
+static double TimeExponentMod( const CMontgomeryContext & mont, const BigNum & a, const BigNum & b )
+{
+	const clock_t kMinClocks = CLOCKS_PER_SEC / 4;
+	const clock_t kStart = clock();
+	clock_t elapsed = 0;
+	int nReps = 0;
+
+	do
+	{
+		mont.ExponentMod( a, b );
+		++nReps;
+		elapsed = clock() - kStart;
+	}
+	while( elapsed < kMinClocks );
+
+	return( 1000000.0 * (double)elapsed / CLOCKS_PER_SEC / nReps );
+}
+
+
+// Exponentiates a full set of lanes of random numbers modulo a random odd n
+// of nBits bits with the multi-buffer kernel (AVX2, if bForceAVX2), checks
+// each lane against the context's ExponentMod(), and prints the outcome.
+// Returns false if any lane differs.
+
+static bool CheckMultiBuffer( int nBits, bool bForceAVX2 )
+{
+	BigNum n;
+	BigNum b;
+	BigNum result;
+	BigNumDigit * apBlocks[knMultiBufferMaxLanes];
+	bool bPassed = true;
+	int j;
+
+	n.SetToRandom( nBits - 1 );
+	n <<= 1;
+	n += BigNum( 1 );
+	b.SetToRandom( nBits );
+
+	const CMontgomeryContext kMont( n );
+	const CMultiBufferMontgomery kMultiBuffer( kMont, true, bForceAVX2 );
+	const CAdditionChain kChain( b );
+	const int knDigits = kMont.GetNumDigits();
+	const int knBlocks = kMultiBuffer.GetNumLanes();
+	vector<BigNum> vA( knBlocks );
+	vector<BigNumDigit> vBlocks( knBlocks * knDigits );
+	vector<BigNumDigit> vWork( kMultiBuffer.GetDigitsWorkSize( kChain ) );
+
+	for( j = 0; j < knBlocks; ++j )
+	{
+		vA[j].SetToRandom( nBits );
+		vA[j] %= n;
+		apBlocks[j] = &vBlocks[j * knDigits];
+		kMont.LoadDigits( apBlocks[j], vA[j] );
+	}
+
+	kMultiBuffer.ExponentModDigits( apBlocks, apBlocks, knBlocks, kChain, &vWork[0] );
+
+	for( j = 0; j < knBlocks; ++j )
+	{
+		kMont.StoreDigits( result, apBlocks[j] );
+
+		if( result != kMont.ExponentMod( vA[j], b ) )
+		{
+			bPassed = false;
+		}
+	}
+
+	printf( "%8d %14s %8s\n", nBits, kMultiBuffer.GetName(), bPassed ? "ok" : "FAILED" );
+	return( bPassed );
+}
+
+
+// Check the multi-buffer kernels, including AVX2 with one- and two-limb moduli,
+// where its last carry is easiest to lose; time each multiplication method
+// on random operands from 2048 to 1048576 bits, to show where the thresholds
+// in BigNumKernels.h should fall; then time Montgomery exponentiation at
+// the fixed widths, with and without FixedBigNum.
+
+void CHelixApp::CommandBenchmarkMultiplication( void ) const
+{
+	static const int aknBitLengths[] = {
+		2048, 4096, 8192, 12288, 16384, 24576, 32768, 49152, 65536,
+		131072, 262144, 524288, 1048576 };
+	const int knNumBitLengths = sizeof( aknBitLengths ) / sizeof( aknBitLengths[0] );
+	static const int aknCheckBitLengths[] = { 20, 26, 28, 56, 64, 512, 2048 };
+	const int knNumCheckBitLengths = sizeof( aknCheckBitLengths ) / sizeof( aknCheckBitLengths[0] );
+	int i;
+
+	printf( "\nDigit kernels: %s\n", DigitsKernelsName() );
+	printf( "\nMulti-buffer exponentiation, checked against one at a time:\n\n" );
+	printf( "%8s %14s %8s\n", "Bits", "Kernel", "Result" );
+
+	for( i = 0; i < knNumCheckBitLengths; ++i )
+	{
+		CheckMultiBuffer( aknCheckBitLengths[i], false );
+		CheckMultiBuffer( aknCheckBitLengths[i], true );
+	}
+
+	printf( "\nMicroseconds per multiplication:\n\n" );
+	printf( "%8s %12s %12s %12s %12s\n", "Bits", "Schoolbook", "Karatsuba", "Toom-3", "NTT" );
+
+	for( i = 0; i < knNumBitLengths; ++i )
+	{
+		const int n = aknBitLengths[i] / knBitsPerDigit;
+		const int knKaratsubaScratchSize = DigitsKaratsubaScratchSize( n );
+		const int knToom3ScratchSize = DigitsToom3ScratchSize( n );
+		vector<BigNumDigit> vA( n );
+		vector<BigNumDigit> vB( n );
+		vector<BigNumDigit> vProduct( 2 * n );
+		vector<BigNumDigit> vScratch( knKaratsubaScratchSize > knToom3ScratchSize ? knKaratsubaScratchSize : knToom3ScratchSize );
+		int j;
+
+		for( j = 0; j < n; ++j )
+		{
+			vA[j] = ( (BigNumDigit)rand() << 48 ) ^ ( (BigNumDigit)rand() << 24 ) ^ (BigNumDigit)rand();
+			vB[j] = ( (BigNumDigit)rand() << 48 ) ^ ( (BigNumDigit)rand() << 24 ) ^ (BigNumDigit)rand();
+		}
+
+		printf( "%8d", aknBitLengths[i] );
+
+		for( j = 0; j < 4; ++j )
+		{
+			printf( " %12.1f", TimeMultiplication( j, n, &vA[0], &vB[0], &vProduct[0], &vScratch[0] ) );
+			fflush( stdout );
+		}
+
+		printf( "\n" );
+	}
+
+	static const int aknFixedBitLengths[] = { 512, 1024, 2048 };
+	const int knNumFixedBitLengths = sizeof( aknFixedBitLengths ) / sizeof( aknFixedBitLengths[0] );
+
+	printf( "\nMicroseconds per modular exponentiation:\n\n" );
+	printf( "%8s %12s %12s\n", "Bits", "Fixed width", "General" );
+
+	for( i = 0; i < knNumFixedBitLengths; ++i )
+	{
+		BigNum n;
+		BigNum a;
+		BigNum b;
+
+		n.SetToRandom( aknFixedBitLengths[i] - 1 );
+		n <<= 1;
+		n += BigNum( 1 );
+		a.SetToRandom( aknFixedBitLengths[i] - 1 );
+		b.SetToRandom( aknFixedBitLengths[i] );
+
+		const CMontgomeryContext kFixed( n );
+		const CMontgomeryContext kGeneral( n, false );
+
+		printf( "%8d", aknFixedBitLengths[i] );
+		printf( " %12.1f", TimeExponentMod( kFixed, a, b ) );
+		fflush( stdout );
+		printf( " %12.1f\n", TimeExponentMod( kGeneral, a, b ) );
+	}
+}
+
+
+// Reads the public keys named in a list file, one filename (without extension)
+// per line, and reports every pair of keys whose moduli share a prime.
+// The batch GCD singles out the moduli that share anything; only those
+// are then compared pairwise (see BatchGCD.h).
+
+void CHelixApp::CommandAuditPublicKeys( void ) const
+{
+	char acFileName[128];
+	char acKeyFileName[128];
+	FILE * listFile = 0;
+	FILE * keyFile = 0;
+	vector<BigNum> vModuli;
+	vector< vector<char> > vvcKeyNames;
+	vector<BigNum> vDivisors;
+	vector<int> vSuspects;
+	int nNumPairs = 0;
+	int i;
+	int j;
+
+	printf( "File listing the public keys (one filename without extension per line) : " );
+	scanf( "%s", acFileName );
+	listFile = fopen( acFileName, "r" );
+
+	if( listFile == 0 )
+	{
+		printf( "Failed to open file '%s' for read.\n", acFileName );
+		return;
+	}
+
+	while( fscanf( listFile, "%123s", acKeyFileName ) == 1 )
+	{
+		const int knNameLength = strlen( acKeyFileName );
+
+		strcat( acKeyFileName, ".pub" );
+		keyFile = fopen( acKeyFileName, "rb" );
+
+		if( keyFile == 0 )
+		{
+			printf( "Failed to open file '%s' for read; skipping it.\n", acKeyFileName );
+			continue;
+		}
+
+		const CHelixRSAKey kKey( keyFile );
+
+		fclose( keyFile );
+		vModuli.push_back( kKey.GetN() );
+		vvcKeyNames.push_back( vector<char>( acKeyFileName, acKeyFileName + knNameLength ) );
+		vvcKeyNames.back().push_back( '\0' );
+	}
+
+	fclose( listFile );
+	printf( "Auditing %d public keys...\n", (int)vModuli.size() );
+	BatchGCD( vModuli, vDivisors );
+
+	for( i = 0; i < (int)vModuli.size(); ++i )
+	{
+
+		if( vDivisors[i] != BigNum( 1 ) )
+		{
+			vSuspects.push_back( i );
+		}
+	}
+
+	for( i = 0; i < (int)vSuspects.size(); ++i )
+	{
+
+		for( j = i + 1; j < (int)vSuspects.size(); ++j )
+		{
+			const BigNum & kN1 = vModuli[vSuspects[i]];
+			const BigNum & kN2 = vModuli[vSuspects[j]];
+			const BigNum kFactor = GCD( kN1, kN2 );
+
+			if( kFactor == BigNum( 1 ) )
+			{
+				continue;
+			}
+
+			printf( "\nKeys '%s' and '%s' %s:\n",
+				&vvcKeyNames[vSuspects[i]][0], &vvcKeyNames[vSuspects[j]][0],
+				( kN1 == kN2 ) ? "have the same modulus" : "share a factor" );
+			kFactor.PrintHex();
+			++nNumPairs;
+		}
+	}
+
+	printf( "\n%d of %d keys share factors with others, in %d pairs.\n",
+		(int)vSuspects.size(), (int)vModuli.size(), nNumPairs );
+}
+
+
 void CHelixApp::Run( void ) const
 {
 	bool bQuit = false;
@@ -556,7 +944,7 @@ void CHelixApp::Run( void ) const
 	do
 	{
 		int nMenuSelection = 0;
-		const int knLastMenuItem = 8;
+		const int knLastMenuItem = 10;
 
 		do
 		{
@@ -568,6 +956,8 @@ void CHelixApp::Run( void ) const
 			printf( "5: Change a private key's password\n" );
 			printf( "6: UUEncode a file\n" );
 			printf( "7: UUDecode a file\n" );
+			printf( "8: Benchmark multiplication\n" );
+			printf( "9: Audit public keys for shared factors\n" );
 			printf( "%d: Quit\n", knLastMenuItem );
 			printf( "\nEnter selection: " );
 			scanf( "%d", &nMenuSelection );
@@ -607,6 +997,14 @@ void CHelixApp::Run( void ) const
 					CommandUUDecodeFile();
 					break;
 
+				case 8:
+					CommandBenchmarkMultiplication();
+					break;
+
+				case 9:
+					CommandAuditPublicKeys();
+					break;
+
 				default:
 					bQuit = true;
 					break;
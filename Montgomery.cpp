@@ -0,0 +1,428 @@
+// Montgomery.cpp - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+#include "Common.h"
+
+
+CMontgomeryContext::CMontgomeryContext( const BigNum & n, bool bUseFixedWidth )
+	: m_n( n ),
+		m_nDigits( n.NumDigits() ),
+		m_ullNInverse( 0 ),
+		m_pfnFixedMultiply( 0 )
+{
+
+	if( n.IsZero()  ||  !n.TestBit( 0 ) )
+	{
+		ThrowException();
+	}
+
+	// Newton's iteration for n^-1 mod 2^64.  Any odd number is its own
+	// inverse mod 2^3, and each step doubles the number of correct bits.
+	const BigNumDigit kullN0 = n.m_v[0];
+	BigNumDigit ullInverse = kullN0;
+	int i;
+
+	for( i = 0; i < 5; ++i )
+	{
+		ullInverse *= 2 - kullN0 * ullInverse;
+	}
+
+	m_ullNInverse = 0 - ullInverse;
+
+	// These are the only divisions the context ever performs.
+	BigNum r( 1 );
+
+	r <<= knBitsPerDigit * m_nDigits;
+	r %= n;
+	m_vOne.resize( m_nDigits );
+	LoadDigits( &m_vOne[0], r );
+	m_vRSquared.resize( m_nDigits );
+	LoadDigits( &m_vRSquared[0], r.SquareMod( n ) );
+
+	if( bUseFixedWidth )
+	{
+		m_pfnFixedMultiply = GetFixedMontgomeryMultiply( n.NumSignificantBits() );
+	}
+}
+
+
+// Work space for MultiplyDigits(): the double-width product,
+// and the multiplication kernel's scratch space.
+
+int CMontgomeryContext::GetWorkSize( void ) const
+{
+	return( 2 * m_nDigits + DigitsMultiplyScratchSize( m_nDigits ) );
+}
+
+
+// Copies a, which must be less than n, into m_nDigits digits.
+
+void CMontgomeryContext::LoadDigits( BigNumDigit * pDst, const BigNum & a ) const
+{
+	const int knDigits = a.NumDigits();
+
+	Assert( a < m_n );
+
+	if( knDigits > 0 )
+	{
+		memcpy( pDst, &a.m_v[0], knDigits * sizeof( BigNumDigit ) );
+	}
+
+	memset( pDst + knDigits, 0, ( m_nDigits - knDigits ) * sizeof( BigNumDigit ) );
+}
+
+
+void CMontgomeryContext::StoreDigits( BigNum & a, const BigNumDigit * pSrc ) const
+{
+	a.m_v.assign( pSrc, pSrc + m_nDigits );
+	a.DiscardLeadingZeros();
+}
+
+
+// The fixed-width product multiplies squares too: at these sizes, its
+// unrolled rows are faster than the general kernels' squaring.
+// Otherwise, if pA and pB are the same, the kernel squares.
+
+void CMontgomeryContext::MultiplyDigits(
+	BigNumDigit * pDst, const BigNumDigit * pA, const BigNumDigit * pB,
+	BigNumDigit * pWork ) const
+{
+
+	if( m_pfnFixedMultiply != 0 )
+	{
+		m_pfnFixedMultiply( pDst, pA, pB, &m_n.m_v[0], m_ullNInverse );
+	}
+	else
+	{
+		DigitsMultiplyBalanced( pWork, pA, pB, m_nDigits, pWork + 2 * m_nDigits );
+		DigitsMontgomeryReduce( pDst, pWork, &m_n.m_v[0], m_nDigits, m_ullNInverse );
+	}
+}
+
+
+// a * R = a * R^2 / R.
+
+void CMontgomeryContext::ToMontgomeryDigits(
+	BigNumDigit * pDst, const BigNumDigit * pA,
+	BigNumDigit * pWork ) const
+{
+	MultiplyDigits( pDst, pA, &m_vRSquared[0], pWork );
+}
+
+
+// The work space comes from the thread's arena; each result is
+// constructed before the scope, so that it can outlive it.
+
+BigNum CMontgomeryContext::ToMontgomery( const BigNum & a ) const
+{
+	BigNum result;
+	CBigNumArenaScope scope;
+	BigNumDigit * pWork = scope.Allocate<BigNumDigit>( m_nDigits + GetWorkSize() );
+
+	LoadDigits( pWork, a );
+	ToMontgomeryDigits( pWork, pWork, pWork + m_nDigits );
+	StoreDigits( result, pWork );
+	return( result );
+}
+
+
+BigNum CMontgomeryContext::FromMontgomery( const BigNum & a ) const
+{
+	BigNum result;
+	CBigNumArenaScope scope;
+	BigNumDigit * pWork = scope.Allocate<BigNumDigit>( 2 * m_nDigits );
+
+	// a = ( a * R ) / R: reduce with a zero high half.
+	LoadDigits( pWork, a );
+	memset( pWork + m_nDigits, 0, m_nDigits * sizeof( BigNumDigit ) );
+	DigitsMontgomeryReduce( pWork + m_nDigits, pWork, &m_n.m_v[0], m_nDigits, m_ullNInverse );
+	StoreDigits( result, pWork + m_nDigits );
+	return( result );
+}
+
+
+BigNum CMontgomeryContext::Multiply( const BigNum & a, const BigNum & b ) const
+{
+	BigNum result;
+	CBigNumArenaScope scope;
+	BigNumDigit * pA = scope.Allocate<BigNumDigit>( 2 * m_nDigits + GetWorkSize() );
+	BigNumDigit * pB = pA + m_nDigits;
+
+	LoadDigits( pA, a );
+	LoadDigits( pB, b );
+	MultiplyDigits( pA, pA, pB, pB + m_nDigits );
+	StoreDigits( result, pA );
+	return( result );
+}
+
+
+BigNum CMontgomeryContext::Square( const BigNum & a ) const
+{
+	BigNum result;
+	CBigNumArenaScope scope;
+	BigNumDigit * pWork = scope.Allocate<BigNumDigit>( m_nDigits + GetWorkSize() );
+
+	LoadDigits( pWork, a );
+	MultiplyDigits( pWork, pWork, pWork, pWork + m_nDigits );
+	StoreDigits( result, pWork );
+	return( result );
+}
+
+
+// The sliding window width for an exponent of nBits bits.
+// Wider windows save multiplications but cost more precomputation.
+
+static int GetWindowWidth( int nBits )
+{
+
+	if( nBits > 671 )
+	{
+		return( 6 );
+	}
+	else if( nBits > 239 )
+	{
+		return( 5 );
+	}
+	else if( nBits > 79 )
+	{
+		return( 4 );
+	}
+	else if( nBits > 23 )
+	{
+		return( 3 );
+	}
+
+	return( 1 );
+}
+
+
+// Work space for the digit-level functions: the table of odd powers,
+// a^2 and the running result for ExponentModDigits(), and MultiplyDigits()' own.
+
+int CMontgomeryContext::GetDigitsWorkSize( const BigNum & b ) const
+{
+	const int knTableSize = 1 << ( GetWindowWidth( b.NumSignificantBits() ) - 1 );
+
+	return( ( knTableSize + 2 ) * m_nDigits + GetWorkSize() );
+}
+
+
+int CMontgomeryContext::GetDigitsWorkSize( const CAdditionChain & chain ) const
+{
+	return( ( chain.GetTableSize() + 2 ) * m_nDigits + GetWorkSize() );
+}
+
+
+// Horner's rule, one m_nDigits-digit chunk c of a at a time, from the top:
+// the running total t becomes t * R + c mod n.  Both steps are Montgomery
+// products: t * R = t * R^2 / R, and c mod n = c * ( R mod n ) / R
+// (c * ( R mod n ) is less than n * R, as the reduction requires).
+
+void CMontgomeryContext::ReduceDigits(
+	BigNumDigit * pDst, const BigNumDigit * pA, int nA,
+	BigNumDigit * pWork ) const
+{
+	BigNumDigit * pChunk = pWork;
+	int nLow = ( ( nA - 1 ) / m_nDigits ) * m_nDigits;
+	bool bStarted = false;
+
+	pWork += m_nDigits;
+	memset( pDst, 0, m_nDigits * sizeof( BigNumDigit ) );
+
+	for( ; nLow >= 0; nLow -= m_nDigits )
+	{
+		const int knChunkDigits = ( nA - nLow < m_nDigits ) ? nA - nLow : m_nDigits;
+
+		if( bStarted )
+		{
+			MultiplyDigits( pDst, pDst, &m_vRSquared[0], pWork );
+		}
+
+		memcpy( pChunk, pA + nLow, knChunkDigits * sizeof( BigNumDigit ) );
+		memset( pChunk + knChunkDigits, 0, ( m_nDigits - knChunkDigits ) * sizeof( BigNumDigit ) );
+		MultiplyDigits( pChunk, pChunk, &m_vOne[0], pWork );
+
+		if( DigitsAdd( pDst, pDst, m_nDigits, pChunk, m_nDigits ) != 0  ||
+			DigitsCompare( pDst, &m_n.m_v[0], m_nDigits ) >= 0 )
+		{
+			DigitsSubtract( pDst, pDst, m_nDigits, &m_n.m_v[0], m_nDigits );
+		}
+
+		bStarted = true;
+	}
+}
+
+
+// a * b / R, then ( a * b / R ) * R^2 / R.
+
+void CMontgomeryContext::MultiplyModDigits(
+	BigNumDigit * pDst, const BigNumDigit * pA, const BigNumDigit * pB,
+	BigNumDigit * pWork ) const
+{
+	MultiplyDigits( pDst, pA, pB, pWork );
+	MultiplyDigits( pDst, pDst, &m_vRSquared[0], pWork );
+}
+
+
+BigNum CMontgomeryContext::ExponentMod( const BigNum & a, const BigNum & b ) const
+{
+	BigNum result;
+	CBigNumArenaScope scope;
+	BigNumDigit * pWork = scope.Allocate<BigNumDigit>( m_nDigits + GetDigitsWorkSize( b ) );
+
+	LoadDigits( pWork, ( a < m_n ) ? a : a % m_n );
+	ExponentModDigits( pWork, pWork, b, pWork + m_nDigits );
+	StoreDigits( result, pWork );
+	return( result );
+}
+
+
+// Left-to-right sliding window exponentiation, entirely in Montgomery form
+// ("Handbook of Applied Cryptography", Algorithm 14.85).
+// The odd powers a, a^3, ..., a^( 2^w - 1 ) are precomputed; the exponent is
+// then consumed in windows of at most w bits that begin and end with a 1,
+// costing one multiplication per window rather than one per set bit.
+
+void CMontgomeryContext::ExponentModDigits(
+	BigNumDigit * pDst, const BigNumDigit * pA, const BigNum & b,
+	BigNumDigit * pWork ) const
+{
+	const int knBits = b.NumSignificantBits();
+	const int knWidth = GetWindowWidth( knBits );
+	const int knTableSize = 1 << ( knWidth - 1 );
+	BigNumDigit * pPowers = pWork;							// a^( 2j + 1 ) at pPowers + j * m_nDigits
+	BigNumDigit * pSquare = pPowers + knTableSize * m_nDigits;	// a^2
+	BigNumDigit * pResult = pSquare + m_nDigits;
+	bool bStarted = false;
+	int i;
+	int j;
+
+	pWork = pResult + m_nDigits;
+	MultiplyDigits( pPowers, pA, &m_vRSquared[0], pWork );
+	MultiplyDigits( pSquare, pPowers, pPowers, pWork );
+
+	for( j = 1; j < knTableSize; ++j )
+	{
+		MultiplyDigits( pPowers + j * m_nDigits, pPowers + ( j - 1 ) * m_nDigits, pSquare, pWork );
+	}
+
+	memcpy( pResult, &m_vOne[0], m_nDigits * sizeof( BigNumDigit ) );
+
+	for( i = knBits - 1; i >= 0; )
+	{
+
+		if( !b.TestBit( i ) )
+		{
+
+			if( bStarted )
+			{
+				MultiplyDigits( pResult, pResult, pResult, pWork );
+			}
+
+			--i;
+			continue;
+		}
+
+		// Find the longest window b[i .. nLow] of at most knWidth bits that ends with a 1.
+		int nLow = ( i - knWidth + 1 > 0 ) ? i - knWidth + 1 : 0;
+		int nWindow = 0;
+
+		while( !b.TestBit( nLow ) )
+		{
+			++nLow;
+		}
+
+		for( j = i; j >= nLow; --j )
+		{
+			nWindow = ( nWindow << 1 ) | ( b.TestBit( j ) ? 1 : 0 );
+
+			if( bStarted )
+			{
+				MultiplyDigits( pResult, pResult, pResult, pWork );
+			}
+		}
+
+		// The first window just copies its power; there is nothing to square yet.
+		const BigNumDigit * kpPower = pPowers + ( nWindow >> 1 ) * m_nDigits;
+
+		if( bStarted )
+		{
+			MultiplyDigits( pResult, pResult, kpPower, pWork );
+		}
+		else
+		{
+			memcpy( pResult, kpPower, m_nDigits * sizeof( BigNumDigit ) );
+			bStarted = true;
+		}
+
+		i = nLow - 1;
+	}
+
+	// Convert back from Montgomery form.
+	memcpy( pWork, pResult, m_nDigits * sizeof( BigNumDigit ) );
+	memset( pWork + m_nDigits, 0, m_nDigits * sizeof( BigNumDigit ) );
+	DigitsMontgomeryReduce( pDst, pWork, &m_n.m_v[0], m_nDigits, m_ullNInverse );
+}
+
+
+// The chain's steps, in Montgomery form.  Only the odd powers that the chain
+// uses are made, and a^2 only if there are any beyond a itself.
+
+void CMontgomeryContext::ExponentModDigits(
+	BigNumDigit * pDst, const BigNumDigit * pA, const CAdditionChain & chain,
+	BigNumDigit * pWork ) const
+{
+	const int knTableSize = chain.GetTableSize();
+	const int knNumSteps = chain.GetNumSteps();
+	BigNumDigit * pPowers = pWork;							// a^( 2j + 1 ) at pPowers + j * m_nDigits
+	BigNumDigit * pSquare = pPowers + knTableSize * m_nDigits;	// a^2
+	BigNumDigit * pResult = pSquare + m_nDigits;
+	int i;
+	int j;
+
+	pWork = pResult + m_nDigits;
+
+	if( knNumSteps == 0 )
+	{
+		memcpy( pResult, &m_vOne[0], m_nDigits * sizeof( BigNumDigit ) );
+	}
+	else
+	{
+		MultiplyDigits( pPowers, pA, &m_vRSquared[0], pWork );
+
+		if( knTableSize > 1 )
+		{
+			MultiplyDigits( pSquare, pPowers, pPowers, pWork );
+
+			for( j = 1; j < knTableSize; ++j )
+			{
+				MultiplyDigits( pPowers + j * m_nDigits, pPowers + ( j - 1 ) * m_nDigits, pSquare, pWork );
+			}
+		}
+
+		memcpy( pResult, pPowers + chain.GetStep( 0 ) * m_nDigits, m_nDigits * sizeof( BigNumDigit ) );
+	}
+
+	for( i = 1; i < knNumSteps; ++i )
+	{
+		const int knStep = chain.GetStep( i );
+
+		if( knStep == CAdditionChain::knSquare )
+		{
+			MultiplyDigits( pResult, pResult, pResult, pWork );
+		}
+		else
+		{
+			MultiplyDigits( pResult, pResult, pPowers + knStep * m_nDigits, pWork );
+		}
+	}
+
+	// Convert back from Montgomery form.
+	memcpy( pWork, pResult, m_nDigits * sizeof( BigNumDigit ) );
+	memset( pWork + m_nDigits, 0, m_nDigits * sizeof( BigNumDigit ) );
+	DigitsMontgomeryReduce( pDst, pWork, &m_n.m_v[0], m_nDigits, m_ullNInverse );
+}
+
+
+// **** End of File ****
@@ -0,0 +1,521 @@
+// MultiBuffer.cpp - Part of Helix
+// Copyright (c) 2002 by Tom Weatherhead.  All rights reserved.
+// Started October 18, 2026
+
+// Multi-buffer Montgomery exponentiation; see MultiBuffer.h.
+
+// The SIMD kernels only do Montgomery multiplication; everything else,
+// from the addition chain to the conversions in and out of the lanes,
+// is ordinary code shared by both of them.
+
+// The multiplication is "almost Montgomery": word by word, with the
+// limbs of the accumulator allowed to grow past the limb size, and only
+// normalized (carried into the next limb) at the end.  With R = 2^( B * k )
+// for k limbs of B bits, and n < R / 4, inputs less than 2n give
+// a result less than 2n, so no subtraction is needed between steps.
+
+#include "Common.h"
+
+#ifdef _HELIX_X86_64_KERNELS_
+#include <immintrin.h>
+#endif
+
+
+// A SIMD implementation of the almost Montgomery product
+// pDst = pA * pB / R mod n (less than 2n), where every number has nLimbs limbs
+// in nLanes lanes, and pAcc holds ( 2 * nLimbs + 1 ) * nLanes digits.
+// pDst may be pA or pB.
+
+class CMultiBufferKernel
+{
+public:
+	int m_nLanes;
+	int m_nLimbBits;
+	int m_nMinBlocks;	// Fewer blocks than this are faster done one at a time
+	void (*m_pfnMultiply)(
+		BigNumDigit * pDst, const BigNumDigit * pA, const BigNumDigit * pB,
+		const BigNumDigit * pN, BigNumDigit ullNInverse, int nLimbs, BigNumDigit * pAcc );
+	const char * m_pcName;
+}; // class CMultiBufferKernel
+
+
+#ifdef _HELIX_X86_64_KERNELS_
+
+// AVX-512 IFMA: VPMADD52LUQ and VPMADD52HUQ add the low and high 52 bits
+// of a 52 x 52-bit product into 64-bit accumulators.  In step i, limb j
+// of the accumulator gets the low halves of a[j] * b[i] and n[j] * m,
+// and the high halves of a[j - 1] * b[i] and n[j - 1] * m.  So each limb
+// gains less than 2^54 per step, and can take 1024 steps before it could
+// overflow; the accumulator is normalized every knIFMANormalizeInterval steps.
+
+static const int knIFMANormalizeInterval = 512;
+
+
+// The limb's carry.  This is VPSRLQ; the masked form avoids a spurious
+// "may be used uninitialized" warning that GCC gives for _mm512_srli_epi64().
+
+__attribute__(( target( "avx512f" ) ))
+static inline __m512i ShiftRight52( __m512i x )
+{
+	return( _mm512_maskz_srli_epi64( 0xFF, x, 52 ) );
+}
+
+
+__attribute__(( target( "avx512f,avx512ifma" ) ))
+static void MultiplyIFMA(
+	BigNumDigit * pDst, const BigNumDigit * pA, const BigNumDigit * pB,
+	const BigNumDigit * pN, BigNumDigit ullNInverse, int nLimbs, BigNumDigit * pAcc )
+{
+	const __m512i kMask = _mm512_set1_epi64( ( 1ULL << 52 ) - 1 );
+	const __m512i kNInverse = _mm512_set1_epi64( ullNInverse );
+	const __m512i kZero = _mm512_setzero_si512();
+	__m512i * pT = (__m512i *)pAcc;
+	const __m512i * pVA = (const __m512i *)pA;
+	const __m512i * pVB = (const __m512i *)pB;
+	const __m512i * pVN = (const __m512i *)pN;
+	int i;
+	int j;
+
+	for( j = 0; j <= 2 * nLimbs; ++j )
+	{
+		_mm512_storeu_si512( pT + j, kZero );
+	}
+
+	for( i = 0; i < nLimbs; ++i )
+	{
+		const __m512i kB = _mm512_loadu_si512( pVB + i );
+		__m512i x = _mm512_madd52lo_epu64( _mm512_loadu_si512( pT + i ), _mm512_loadu_si512( pVA ), kB );
+		const __m512i kM = _mm512_madd52lo_epu64( kZero, x, kNInverse );
+		__m512i aPrev = _mm512_loadu_si512( pVA );
+		__m512i nPrev = _mm512_loadu_si512( pVN );
+
+		// The low 52 bits of limb i are now 0; the rest carries into limb i + 1.
+		x = _mm512_madd52lo_epu64( x, nPrev, kM );
+		x = _mm512_add_epi64( _mm512_loadu_si512( pT + i + 1 ), ShiftRight52( x ) );
+
+		for( j = 1; j < nLimbs; ++j )
+		{
+			const __m512i kA = _mm512_loadu_si512( pVA + j );
+			const __m512i kN = _mm512_loadu_si512( pVN + j );
+
+			x = _mm512_madd52hi_epu64( x, aPrev, kB );
+			x = _mm512_madd52hi_epu64( x, nPrev, kM );
+			x = _mm512_madd52lo_epu64( x, kA, kB );
+			x = _mm512_madd52lo_epu64( x, kN, kM );
+			_mm512_storeu_si512( pT + i + j, x );
+			x = _mm512_loadu_si512( pT + i + j + 1 );
+			aPrev = kA;
+			nPrev = kN;
+		}
+
+		x = _mm512_madd52hi_epu64( x, aPrev, kB );
+		x = _mm512_madd52hi_epu64( x, nPrev, kM );
+		_mm512_storeu_si512( pT + i + nLimbs, x );
+
+		if( ( i + 1 ) % knIFMANormalizeInterval == 0 )
+		{
+
+			for( j = i + 1; j < i + nLimbs; ++j )
+			{
+				x = _mm512_loadu_si512( pT + j );
+				_mm512_storeu_si512( pT + j + 1, _mm512_add_epi64( _mm512_loadu_si512( pT + j + 1 ), ShiftRight52( x ) ) );
+				_mm512_storeu_si512( pT + j, _mm512_and_si512( x, kMask ) );
+			}
+		}
+	}
+
+	// The result is in limbs nLimbs .. 2 * nLimbs - 1; it is less than R, so nothing carries out.
+	__m512i carry = kZero;
+
+	for( j = 0; j < nLimbs; ++j )
+	{
+		const __m512i kX = _mm512_add_epi64( _mm512_loadu_si512( pT + nLimbs + j ), carry );
+
+		carry = ShiftRight52( kX );
+		_mm512_storeu_si512( (__m512i *)pDst + j, _mm512_and_si512( kX, kMask ) );
+	}
+}
+
+
+// AVX2: VPMULUDQ multiplies the low 32 bits of each 64-bit lane, giving
+// a whole 56-bit product of 28-bit limbs.  In step i, limb j of the accumulator
+// gets a[j] * b[i] and n[j] * m, so it gains less than 2^57 per step;
+// normalizing every knAVX2NormalizeInterval steps keeps it below 2^63.
+
+static const int knAVX2NormalizeInterval = 32;
+
+
+__attribute__(( target( "avx2" ) ))
+static void MultiplyAVX2(
+	BigNumDigit * pDst, const BigNumDigit * pA, const BigNumDigit * pB,
+	const BigNumDigit * pN, BigNumDigit ullNInverse, int nLimbs, BigNumDigit * pAcc )
+{
+	const __m256i kMask = _mm256_set1_epi64x( ( 1LL << 28 ) - 1 );
+	const __m256i kNInverse = _mm256_set1_epi64x( (long long)ullNInverse );
+	const __m256i kZero = _mm256_setzero_si256();
+	__m256i * pT = (__m256i *)pAcc;
+	const __m256i * pVA = (const __m256i *)pA;
+	const __m256i * pVB = (const __m256i *)pB;
+	const __m256i * pVN = (const __m256i *)pN;
+	int i;
+	int j;
+
+	for( j = 0; j <= 2 * nLimbs; ++j )
+	{
+		_mm256_storeu_si256( pT + j, kZero );
+	}
+
+	for( i = 0; i < nLimbs; ++i )
+	{
+		const __m256i kB = _mm256_loadu_si256( pVB + i );
+		__m256i x = _mm256_add_epi64( _mm256_loadu_si256( pT + i ),
+			_mm256_mul_epu32( _mm256_loadu_si256( pVA ), kB ) );
+		const __m256i kM = _mm256_and_si256( _mm256_mul_epu32( x, kNInverse ), kMask );
+
+		// The low 28 bits of limb i are now 0; the rest carries into limb i + 1.
+		x = _mm256_add_epi64( x, _mm256_mul_epu32( _mm256_loadu_si256( pVN ), kM ) );
+		x = _mm256_add_epi64( _mm256_loadu_si256( pT + i + 1 ), _mm256_srli_epi64( x, 28 ) );
+
+		for( j = 1; j < nLimbs; ++j )
+		{
+			x = _mm256_add_epi64( x, _mm256_mul_epu32( _mm256_loadu_si256( pVA + j ), kB ) );
+			x = _mm256_add_epi64( x, _mm256_mul_epu32( _mm256_loadu_si256( pVN + j ), kM ) );
+			_mm256_storeu_si256( pT + i + j, x );
+			x = _mm256_loadu_si256( pT + i + j + 1 );
+		}
+
+		// With one limb, this is limb i + 1 and its carry, which the loop never stored.
+		_mm256_storeu_si256( pT + i + nLimbs, x );
+
+		if( ( i + 1 ) % knAVX2NormalizeInterval == 0 )
+		{
+
+			for( j = i + 1; j < i + nLimbs; ++j )
+			{
+				x = _mm256_loadu_si256( pT + j );
+				_mm256_storeu_si256( pT + j + 1, _mm256_add_epi64( _mm256_loadu_si256( pT + j + 1 ), _mm256_srli_epi64( x, 28 ) ) );
+				_mm256_storeu_si256( pT + j, _mm256_and_si256( x, kMask ) );
+			}
+		}
+	}
+
+	__m256i carry = kZero;
+
+	for( j = 0; j < nLimbs; ++j )
+	{
+		const __m256i kX = _mm256_add_epi64( _mm256_loadu_si256( pT + nLimbs + j ), carry );
+
+		carry = _mm256_srli_epi64( kX, 28 );
+		_mm256_storeu_si256( (__m256i *)pDst + j, _mm256_and_si256( kX, kMask ) );
+	}
+}
+
+
+static const CMultiBufferKernel kIFMAKernel = { 8, 52, 3, MultiplyIFMA, "AVX-512 IFMA" };
+static const CMultiBufferKernel kAVX2Kernel = { 4, 28, 3, MultiplyAVX2, "AVX2" };
+
+#endif // _HELIX_X86_64_KERNELS_
+
+
+static const CMultiBufferKernel * SelectKernel( bool bUseSIMD, bool bForceAVX2 )
+{
+
+	if( !bUseSIMD )
+	{
+		return( 0 );
+	}
+
+#ifdef _HELIX_X86_64_KERNELS_
+	__builtin_cpu_init();
+
+	if( bForceAVX2 )
+	{
+		return( __builtin_cpu_supports( "avx2" ) ? &kAVX2Kernel : 0 );
+	}
+
+	if( __builtin_cpu_supports( "avx512f" )  &&  __builtin_cpu_supports( "avx512ifma" ) )
+	{
+		return( &kIFMAKernel );
+	}
+
+	// Four lanes of 28-bit limbs are almost twice as fast as the portable digit
+	// kernels, but no faster than the MULX/ADX ones (see BigNumKernels.h).
+
+	if( __builtin_cpu_supports( "avx2" )  &&  !DigitsCPUHasMulxAdx() )
+	{
+		return( &kAVX2Kernel );
+	}
+#endif
+
+	return( 0 );
+}
+
+
+CMultiBufferMontgomery::CMultiBufferMontgomery( const CMontgomeryContext & mont, bool bUseSIMD, bool bForceAVX2 )
+	: m_mont( mont ),
+		m_pKernel( SelectKernel( bUseSIMD, bForceAVX2 ) ),
+		m_nLanes( 1 ),
+		m_nLimbs( 0 ),
+		m_ullNInverse( 0 )
+{
+
+	if( m_pKernel == 0 )
+	{
+		return;
+	}
+
+	const BigNum & n = mont.GetModulus();
+	const int knLimbBits = m_pKernel->m_nLimbBits;
+	const BigNumDigit kullMask = ( (BigNumDigit)1 << knLimbBits ) - 1;
+	BigNumDigit ullInverse = n.m_v[0];	// n^-1 mod 2^3, and each step doubles the bits
+	int i;
+	int j;
+
+	m_nLanes = m_pKernel->m_nLanes;
+
+	// n < R / 4, as the almost Montgomery product requires.
+	m_nLimbs = ( n.NumSignificantBits() + 2 + knLimbBits - 1 ) / knLimbBits;
+
+	for( i = 0; i < 5; ++i )
+	{
+		ullInverse *= 2 - n.m_v[0] * ullInverse;
+	}
+
+	m_ullNInverse = ( 0 - ullInverse ) & kullMask;
+
+	BigNum rSquared( 1 );
+
+	rSquared <<= 2 * knLimbBits * m_nLimbs;
+	rSquared %= n;
+
+	vector<BigNumDigit> vDigits( mont.GetNumDigits() );
+
+	m_vN.resize( m_nLimbs * m_nLanes );
+	m_vRSquared.resize( m_nLimbs * m_nLanes );
+	m_vOne.resize( m_nLimbs * m_nLanes );
+
+	for( j = 0; j < m_nLanes; ++j )
+	{
+		memset( &vDigits[0], 0, vDigits.size() * sizeof( BigNumDigit ) );
+		memcpy( &vDigits[0], &n.m_v[0], n.NumDigits() * sizeof( BigNumDigit ) );
+		LoadLane( &m_vN[0], j, &vDigits[0] );
+		memset( &vDigits[0], 0, vDigits.size() * sizeof( BigNumDigit ) );
+		memcpy( &vDigits[0], &rSquared.m_v[0], rSquared.NumDigits() * sizeof( BigNumDigit ) );
+		LoadLane( &m_vRSquared[0], j, &vDigits[0] );
+		m_vOne[j] = 1;
+	}
+}
+
+
+const char * CMultiBufferMontgomery::GetName( void ) const
+{
+	return( ( m_pKernel != 0 ) ? m_pKernel->m_pcName : "scalar" );
+}
+
+
+// The chain's odd powers of a, a^2, the running result, and the accumulator;
+// or else the context's own work space.
+
+int CMultiBufferMontgomery::GetDigitsWorkSize( const CAdditionChain & chain ) const
+{
+	const int knScalarSize = m_mont.GetDigitsWorkSize( chain );
+
+	if( m_pKernel == 0 )
+	{
+		return( knScalarSize );
+	}
+
+	const int knVectorSize = m_nLimbs * m_nLanes;
+	const int knSIMDSize = ( chain.GetTableSize() + 4 ) * knVectorSize + m_nLanes;
+
+	return( ( knSIMDSize > knScalarSize ) ? knSIMDSize : knScalarSize );
+}
+
+
+// Splits a number of GetNumDigits() digits into limbs, in lane nLane of pDst.
+
+void CMultiBufferMontgomery::LoadLane( BigNumDigit * pDst, int nLane, const BigNumDigit * pSrc ) const
+{
+	const int knLimbBits = m_pKernel->m_nLimbBits;
+	const int knDigits = m_mont.GetNumDigits();
+	const BigNumDigit kullMask = ( (BigNumDigit)1 << knLimbBits ) - 1;
+	int i;
+
+	for( i = 0; i < m_nLimbs; ++i )
+	{
+		const int knBit = i * knLimbBits;
+		const int knDigit = knBit / knBitsPerDigit;
+		const int knShift = knBit % knBitsPerDigit;
+		BigNumDigit ullLimb = 0;
+
+		if( knDigit < knDigits )
+		{
+			ullLimb = pSrc[knDigit] >> knShift;
+
+			if( knShift + knLimbBits > knBitsPerDigit  &&  knDigit + 1 < knDigits )
+			{
+				ullLimb |= pSrc[knDigit + 1] << ( knBitsPerDigit - knShift );
+			}
+		}
+
+		pDst[i * m_nLanes + nLane] = ullLimb & kullMask;
+	}
+}
+
+
+// The reverse of LoadLane(), for a normalized number less than 2^( 64 * GetNumDigits() ).
+
+void CMultiBufferMontgomery::StoreLane( BigNumDigit * pDst, const BigNumDigit * pSrc, int nLane ) const
+{
+	const int knLimbBits = m_pKernel->m_nLimbBits;
+	const int knDigits = m_mont.GetNumDigits();
+	int i;
+
+	memset( pDst, 0, knDigits * sizeof( BigNumDigit ) );
+
+	for( i = 0; i < m_nLimbs; ++i )
+	{
+		const int knBit = i * knLimbBits;
+		const int knDigit = knBit / knBitsPerDigit;
+		const int knShift = knBit % knBitsPerDigit;
+		const BigNumDigit kullLimb = pSrc[i * m_nLanes + nLane];
+
+		if( knDigit < knDigits )
+		{
+			pDst[knDigit] |= kullLimb << knShift;
+
+			if( knShift + knLimbBits > knBitsPerDigit  &&  knDigit + 1 < knDigits )
+			{
+				pDst[knDigit + 1] |= kullLimb >> ( knBitsPerDigit - knShift );
+			}
+		}
+	}
+}
+
+
+inline void CMultiBufferMontgomery::Multiply(
+	BigNumDigit * pDst, const BigNumDigit * pA, const BigNumDigit * pB, BigNumDigit * pWork ) const
+{
+	m_pKernel->m_pfnMultiply( pDst, pA, pB, &m_vN[0], m_ullNInverse, m_nLimbs, pWork );
+}
+
+
+// The blocks are done a pass of m_nLanes at a time; a pass with too few
+// blocks to fill the lanes profitably is done one block at a time instead.
+
+void CMultiBufferMontgomery::ExponentModDigits(
+	BigNumDigit * const * ppDst, const BigNumDigit * const * ppA, int nBlocks,
+	const CAdditionChain & chain, BigNumDigit * pWork ) const
+{
+	int nFirst;
+	int j;
+
+	Assert( nBlocks <= knMultiBufferMaxLanes );
+
+	for( nFirst = 0; nFirst < nBlocks; nFirst += m_nLanes )
+	{
+		const int knCount = ( nBlocks - nFirst < m_nLanes ) ? nBlocks - nFirst : m_nLanes;
+
+		if( m_pKernel != 0  &&  knCount >= m_pKernel->m_nMinBlocks )
+		{
+			ExponentModLanes( ppDst + nFirst, ppA + nFirst, knCount, chain, pWork );
+			continue;
+		}
+
+		for( j = nFirst; j < nFirst + knCount; ++j )
+		{
+			m_mont.ExponentModDigits( ppDst[j], ppA[j], chain, pWork );
+		}
+	}
+}
+
+
+// The chain's steps, for up to m_nLanes blocks.  Every lane shares the
+// exponent, so every lane takes the same steps; unused lanes just compute 0^b.
+
+void CMultiBufferMontgomery::ExponentModLanes(
+	BigNumDigit * const * ppDst, const BigNumDigit * const * ppA, int nBlocks,
+	const CAdditionChain & chain, BigNumDigit * pWork ) const
+{
+	const int knTableSize = chain.GetTableSize();
+	const int knNumSteps = chain.GetNumSteps();
+	const int knVectorSize = m_nLimbs * m_nLanes;
+	const int knDigits = m_mont.GetNumDigits();
+	const BigNumDigit * kpN = &m_mont.GetModulus().m_v[0];
+	BigNumDigit * pTable = pWork;								// a^( 2j + 1 ) at pTable + j * knVectorSize
+	BigNumDigit * pSquare = pTable + knTableSize * knVectorSize;	// a^2
+	BigNumDigit * pResult = pSquare + knVectorSize;
+	BigNumDigit * pAcc = pResult + knVectorSize;
+	int i;
+	int j;
+
+	if( knNumSteps == 0 )
+	{
+		Multiply( pResult, &m_vRSquared[0], &m_vOne[0], pAcc );
+	}
+	else
+	{
+		// Into the lanes, and into Montgomery form.
+
+		for( j = 0; j < m_nLanes; ++j )
+		{
+
+			if( j < nBlocks )
+			{
+				LoadLane( pResult, j, ppA[j] );
+			}
+			else
+			{
+
+				for( i = 0; i < m_nLimbs; ++i )
+				{
+					pResult[i * m_nLanes + j] = 0;
+				}
+			}
+		}
+
+		Multiply( pTable, pResult, &m_vRSquared[0], pAcc );
+
+		if( knTableSize > 1 )
+		{
+			Multiply( pSquare, pTable, pTable, pAcc );
+
+			for( j = 1; j < knTableSize; ++j )
+			{
+				Multiply( pTable + j * knVectorSize, pTable + ( j - 1 ) * knVectorSize, pSquare, pAcc );
+			}
+		}
+
+		memcpy( pResult, pTable + chain.GetStep( 0 ) * knVectorSize, knVectorSize * sizeof( BigNumDigit ) );
+	}
+
+	for( i = 1; i < knNumSteps; ++i )
+	{
+		const int knStep = chain.GetStep( i );
+
+		if( knStep == CAdditionChain::knSquare )
+		{
+			Multiply( pResult, pResult, pResult, pAcc );
+		}
+		else
+		{
+			Multiply( pResult, pResult, pTable + knStep * knVectorSize, pAcc );
+		}
+	}
+
+	// Out of Montgomery form, which leaves each lane at most n, and out of the lanes.
+	Multiply( pResult, pResult, &m_vOne[0], pAcc );
+
+	for( j = 0; j < nBlocks; ++j )
+	{
+		StoreLane( ppDst[j], pResult, j );
+
+		if( DigitsCompare( ppDst[j], kpN, knDigits ) >= 0 )
+		{
+			DigitsSubtract( ppDst[j], ppDst[j], knDigits, kpN, knDigits );
+		}
+	}
+}
+
+
+// **** End of File ****
@@ -8,12 +8,54 @@
 CHelixRSAKey::CHelixRSAKey( bool bIsPrivate, const CVersion & v, const BigNum & e, const BigNum & n )
 	: m_version( v ),
 		m_bIsPrivate( bIsPrivate ),
+		m_bHasCRT( false ),
 		m_exponent( e ),
 		m_n( n )
 {
 }
 
 
+// A private key with its CRT components; vPrimes holds the prime factors of n.
+
+CHelixRSAKey::CHelixRSAKey(
+	const CVersion & v, const BigNum & d, const BigNum & n,
+	const vector<BigNum> & vPrimes )
+	: m_version( v ),
+		m_bIsPrivate( true ),
+		m_bHasCRT( true ),
+		m_exponent( d ),
+		m_n( n ),
+		m_p( vPrimes[0] ),
+		m_q( vPrimes[1] ),
+		m_dP( d % ( vPrimes[0] - BigNum( 1 ) ) ),
+		m_dQ( d % ( vPrimes[1] - BigNum( 1 ) ) )
+{
+	BigNum product = m_p * m_q;
+	int i;
+
+	if( !MultiplicativeInverse( m_q, m_p, m_qInv ) )
+	{
+		ThrowHelixException( "The primes of an RSA key are not coprime." );
+	}
+
+	for( i = 2; i < (int)vPrimes.size(); ++i )
+	{
+		CRSAOtherPrime other;
+
+		other.m_r = vPrimes[i];
+		other.m_d = d % ( other.m_r - BigNum( 1 ) );
+
+		if( !MultiplicativeInverse( product % other.m_r, other.m_r, other.m_t ) )
+		{
+			ThrowHelixException( "The primes of an RSA key are not coprime." );
+		}
+
+		m_vOtherPrimes.push_back( other );
+		product *= other.m_r;
+	}
+}
+
+
 CHelixRSAKey::CHelixRSAKey( FILE * pSrcFile )
 {
 	m_version.ReadFromFile( pSrcFile );
@@ -31,6 +73,10 @@ CHelixRSAKey::CHelixRSAKey( FILE * pSrcFile )
 #endif
 
 	m_bIsPrivate = ( unBitField & 1 ) != 0;
+	m_bHasCRT = m_bIsPrivate  &&  ( unBitField & 2 ) != 0;
+
+	const int knNumOtherPrimes = m_bHasCRT ? ( unBitField >> 8 ) & 255 : 0;
+	int i;
 
 	printf( "Reading a version " );
 	m_version.Print();
@@ -39,9 +85,29 @@ CHelixRSAKey::CHelixRSAKey( FILE * pSrcFile )
 	m_exponent.ReadFromFile( pSrcFile );
 	m_n.ReadFromFile( pSrcFile );
 
+	if( m_bHasCRT )
+	{
+		m_p.ReadFromFile( pSrcFile );
+		m_q.ReadFromFile( pSrcFile );
+		m_dP.ReadFromFile( pSrcFile );
+		m_dQ.ReadFromFile( pSrcFile );
+		m_qInv.ReadFromFile( pSrcFile );
+		m_vOtherPrimes.resize( knNumOtherPrimes );
+
+		for( i = 0; i < knNumOtherPrimes; ++i )
+		{
+			m_vOtherPrimes[i].m_r.ReadFromFile( pSrcFile );
+			m_vOtherPrimes[i].m_d.ReadFromFile( pSrcFile );
+			m_vOtherPrimes[i].m_t.ReadFromFile( pSrcFile );
+		}
+	}
+
 	if( m_bIsPrivate )
 	{
-		HashNumbers( m_exponent, m_n );
+		char acPassword[41];
+
+		GetPassword( acPassword, sizeof( acPassword ) );
+		HashPrivateNumbers( acPassword );
 	}
 }
 
@@ -52,11 +118,17 @@ void CHelixRSAKey::WriteToFile( FILE * pDstFile ) const
 	// 12 bytes for the version of Helix that created it;
 	// 4 bytes for a bitfield:
 	// - bit 0 : 0 for public key, 1 for private.
+	// - bit 1 : 1 if a private key's CRT components follow n (since 0.2.0).
+	// - bits 8 to 15 : the number of ( r, d, t ) triples after qInv,
+	//   for the primes of a multi-prime key beyond p and q (since 0.2.0).
+	// Older versions ignore these bits and the numbers after n.
 	m_version.WriteToFile( pDstFile );
 
 	unsigned int unBitField = 0;
 
 	unBitField |= m_bIsPrivate ? 1 : 0;
+	unBitField |= m_bHasCRT ? 2 : 0;
+	unBitField |= (unsigned int)m_vOtherPrimes.size() << 8;
 
 #ifdef BIG_ENDIAN
 	ByteSwapUnsignedInt( unBitField );
@@ -70,13 +142,31 @@ void CHelixRSAKey::WriteToFile( FILE * pDstFile ) const
 
 	if( m_bIsPrivate )
 	{
-		// WriteToFile() is const, so hash copies of the numbers.
-		BigNum e = m_exponent;
-		BigNum n = m_n;
+		// WriteToFile() is const, so hash a copy of the key.
+		CHelixRSAKey hashed( *this );
+		char acPassword[41];
+		int i;
 
-		HashNumbers( e, n );
-		e.WriteToFile( pDstFile );
-		n.WriteToFile( pDstFile );
+		GetPassword( acPassword, sizeof( acPassword ) );
+		hashed.HashPrivateNumbers( acPassword );
+		hashed.m_exponent.WriteToFile( pDstFile );
+		hashed.m_n.WriteToFile( pDstFile );
+
+		if( m_bHasCRT )
+		{
+			hashed.m_p.WriteToFile( pDstFile );
+			hashed.m_q.WriteToFile( pDstFile );
+			hashed.m_dP.WriteToFile( pDstFile );
+			hashed.m_dQ.WriteToFile( pDstFile );
+			hashed.m_qInv.WriteToFile( pDstFile );
+
+			for( i = 0; i < (int)m_vOtherPrimes.size(); ++i )
+			{
+				hashed.m_vOtherPrimes[i].m_r.WriteToFile( pDstFile );
+				hashed.m_vOtherPrimes[i].m_d.WriteToFile( pDstFile );
+				hashed.m_vOtherPrimes[i].m_t.WriteToFile( pDstFile );
+			}
+		}
 	}
 	else
 	{
@@ -86,23 +176,356 @@ void CHelixRSAKey::WriteToFile( FILE * pDstFile ) const
 }
 
 
-void CHelixRSAKey::HashNumbers( BigNum & d, BigNum & n )
+void CHelixRSAKey::GetPassword( char * pcPassword, int nBufferSize )
 {
-	// After reading or before writing the private key,
-	// encrypt d and n using an XOR with a password.
-	char acPassword[41];
 
 	do
 	{
-		printf( "Private key password (8 to %d chars): ", (int)(sizeof( acPassword ) - 1) );
-		acPassword[0] = '\0';
-		scanf( "%s", acPassword );
+		printf( "Private key password (8 to %d chars): ", nBufferSize - 1 );
+		pcPassword[0] = '\0';
+		scanf( "%s", pcPassword );
+	}
+	while( strlen( pcPassword ) < 8 );
+}
+
+
+// After reading or before writing the private key,
+// encrypt all of its numbers using an XOR with the password.
+
+void CHelixRSAKey::HashPrivateNumbers( const char * pcPassword )
+{
+	int i;
+
+	m_exponent.HashWithString( pcPassword );
+	m_n.HashWithString( pcPassword );
+
+	if( m_bHasCRT )
+	{
+		m_p.HashWithString( pcPassword );
+		m_q.HashWithString( pcPassword );
+		m_dP.HashWithString( pcPassword );
+		m_dQ.HashWithString( pcPassword );
+		m_qInv.HashWithString( pcPassword );
+	}
+
+	for( i = 0; i < (int)m_vOtherPrimes.size(); ++i )
+	{
+		m_vOtherPrimes[i].m_r.HashWithString( pcPassword );
+		m_vOtherPrimes[i].m_d.HashWithString( pcPassword );
+		m_vOtherPrimes[i].m_t.HashWithString( pcPassword );
 	}
-	while( strlen( acPassword ) < 8 );
+}
+
+
+void CHelixRSAKey::HashNumbers( BigNum & d, BigNum & n )
+{
+	char acPassword[41];
 
+	GetPassword( acPassword, sizeof( acPassword ) );
 	d.HashWithString( acPassword );
 	n.HashWithString( acPassword );
 }
 
 
+// Computes x^d mod r for one prime r of a CRT key, on a thread of its own,
+// for a batch of blocks.  The thread waits for Start(), and Finish() waits for
+// the results; the worker's own factory means that it shares no scratch space.
+
+class CRSAPrimeWorker
+{
+private:
+	const CMultiBufferMontgomery & m_mb;
+	const CAdditionChain & m_chain;
+	CLBigNumFactory m_factory;
+	CLBigNum * m_apResults[knMultiBufferMaxLanes];
+	const CLBigNum * const * m_ppX;		// The blocks to work on; 0 when there are none.
+	int m_nBlocks;
+	bool m_bDone;
+	bool m_bFailed;
+	bool m_bQuit;
+	mutex m_mutex;
+	condition_variable m_condition;
+	thread m_thread;
+
+	static void ThreadMain( CRSAPrimeWorker * pWorker );
+
+public:
+	CRSAPrimeWorker( const CMultiBufferMontgomery & mb, const CAdditionChain & chain, int nCapacity );
+	~CRSAPrimeWorker( void );	// Not virtual, so not part of a class heirarchy.
+	void Start( const CLBigNum * const * ppX, int nBlocks );
+	const CLBigNum * const * Finish( void );
+}; // class CRSAPrimeWorker
+
+
+// The results are acquired before the thread is started, so it never sees them change.
+
+CRSAPrimeWorker::CRSAPrimeWorker( const CMultiBufferMontgomery & mb, const CAdditionChain & chain, int nCapacity )
+	: m_mb( mb ),
+		m_chain( chain ),
+		m_factory( nCapacity ),
+		m_ppX( 0 ),
+		m_nBlocks( 0 ),
+		m_bDone( false ),
+		m_bFailed( false ),
+		m_bQuit( false )
+{
+	int i;
+
+	for( i = 0; i < knMultiBufferMaxLanes; ++i )
+	{
+		m_apResults[i] = m_factory.Acquire();
+	}
+
+	m_thread = thread( ThreadMain, this );
+}
+
+
+CRSAPrimeWorker::~CRSAPrimeWorker( void )
+{
+	int i;
+
+	{
+		unique_lock<mutex> lock( m_mutex );
+
+		m_bQuit = true;
+		m_condition.notify_all();
+	}
+
+	m_thread.join();
+
+	for( i = 0; i < knMultiBufferMaxLanes; ++i )
+	{
+		m_factory.Release( m_apResults[i] );
+	}
+}
+
+
+void CRSAPrimeWorker::ThreadMain( CRSAPrimeWorker * pWorker )
+{
+	unique_lock<mutex> lock( pWorker->m_mutex );
+
+	for( ; ; )
+	{
+
+		while( pWorker->m_ppX == 0  &&  !pWorker->m_bQuit )
+		{
+			pWorker->m_condition.wait( lock );
+		}
+
+		if( pWorker->m_bQuit )
+		{
+			break;
+		}
+
+		// The blocks and the results aren't touched by the other thread until Finish().
+		lock.unlock();
+
+		try
+		{
+			CLBigNum::ExponentMod(
+				pWorker->m_apResults, pWorker->m_ppX, pWorker->m_nBlocks,
+				pWorker->m_chain, pWorker->m_mb );
+		}
+		catch( ... )
+		{
+			pWorker->m_bFailed = true;
+		}
+
+		lock.lock();
+		pWorker->m_ppX = 0;
+		pWorker->m_bDone = true;
+		pWorker->m_condition.notify_all();
+	}
+}
+
+
+void CRSAPrimeWorker::Start( const CLBigNum * const * ppX, int nBlocks )
+{
+	unique_lock<mutex> lock( m_mutex );
+
+	m_ppX = ppX;
+	m_nBlocks = nBlocks;
+	m_bDone = false;
+	m_bFailed = false;
+	m_condition.notify_all();
+}
+
+
+const CLBigNum * const * CRSAPrimeWorker::Finish( void )
+{
+	unique_lock<mutex> lock( m_mutex );
+
+	while( !m_bDone )
+	{
+		m_condition.wait( lock );
+	}
+
+	if( m_bFailed )
+	{
+		ThrowHelixException( "A CRT exponentiation failed." );
+	}
+
+	return( m_apResults );
+}
+
+
+// Every number the engine uses has at most two more digits than n.
+
+CRSAKeyEngine::CRSAKeyEngine( const CHelixRSAKey & key )
+	: m_key( key ),
+		m_factory( key.GetN().NumDigits() + 2 )
+{
+
+	if( !key.HasCRT() )
+	{
+		m_vContexts.push_back( CMontgomeryContext( key.GetN() ) );
+		m_vMultiBuffers.push_back( new CMultiBufferMontgomery( m_vContexts[0] ) );
+		m_vChains.push_back( CAdditionChain( key.GetExponent() ) );
+		return;
+	}
+
+	const vector<CRSAOtherPrime> & kvOtherPrimes = key.GetOtherPrimes();
+	const int knNumOtherPrimes = kvOtherPrimes.size();
+	BigNum product = key.GetQ();
+	int i;
+
+	m_vContexts.push_back( CMontgomeryContext( key.GetP() ) );
+	m_vContexts.push_back( CMontgomeryContext( key.GetQ() ) );
+	m_vChains.push_back( CAdditionChain( key.GetDP() ) );
+	m_vChains.push_back( CAdditionChain( key.GetDQ() ) );
+
+	for( i = 0; i < knNumOtherPrimes; ++i )
+	{
+		m_vContexts.push_back( CMontgomeryContext( kvOtherPrimes[i].m_r ) );
+		m_vChains.push_back( CAdditionChain( kvOtherPrimes[i].m_d ) );
+	}
+
+	// The contexts and chains are all in place, so the references to them stay valid.
+
+	for( i = 0; i < (int)m_vContexts.size(); ++i )
+	{
+		m_vMultiBuffers.push_back( new CMultiBufferMontgomery( m_vContexts[i] ) );
+	}
+
+	for( i = 0; i <= knNumOtherPrimes; ++i )
+	{
+		const BigNum & kPrime = ( i == 0 ) ? key.GetP() : kvOtherPrimes[i - 1].m_r;
+		const BigNum & kCoefficient = ( i == 0 ) ? key.GetQInv() : kvOtherPrimes[i - 1].m_t;
+
+		m_vPrimes.push_back( AcquireConstant( kPrime ) );
+		m_vCoefficients.push_back( AcquireConstant( kCoefficient ) );
+		m_vProducts.push_back( AcquireConstant( product ) );
+		m_vWorkers.push_back( new CRSAPrimeWorker(
+			*m_vMultiBuffers[( i == 0 ) ? 0 : i + 1], m_vChains[( i == 0 ) ? 0 : i + 1], m_factory.GetCapacity() ) );
+		product *= kPrime;
+	}
+}
+
+
+CRSAKeyEngine::~CRSAKeyEngine( void )
+{
+	int i;
+
+	for( i = 0; i < (int)m_vWorkers.size(); ++i )
+	{
+		delete m_vWorkers[i];
+		m_factory.Release( m_vPrimes[i] );
+		m_factory.Release( m_vCoefficients[i] );
+		m_factory.Release( m_vProducts[i] );
+	}
+
+	for( i = 0; i < (int)m_vMultiBuffers.size(); ++i )
+	{
+		delete m_vMultiBuffers[i];
+	}
+}
+
+
+CLBigNum * CRSAKeyEngine::AcquireConstant( const BigNum & value )
+{
+	CLBigNum * p = m_factory.Acquire();
+
+	*p = value;
+	return( p );
+}
+
+
+void CRSAKeyEngine::Apply( const CLBigNum & x, CLBigNum & y )
+{
+	const CLBigNum * pX = &x;
+	CLBigNum * pY = &y;
+
+	Apply( &pX, &pY, 1 );
+}
+
+
+void CRSAKeyEngine::Apply( const CLBigNum * const * ppX, CLBigNum * const * ppY, int nBlocks )
+{
+
+	if( !m_key.HasCRT() )
+	{
+		CLBigNum::ExponentMod( ppY, ppX, nBlocks, m_vChains[0], *m_vMultiBuffers[0] );
+		return;
+	}
+
+	// m1 = x^dP mod p and mi = x^di mod ri on the workers; m = m2 = x^dQ mod q on this thread.
+	const int knNumPrimes = m_vWorkers.size();
+	CLBigNumPtr mModPrime( m_factory );
+	CLBigNumPtr h( m_factory );
+	int i;
+	int j;
+
+	for( i = 0; i < knNumPrimes; ++i )
+	{
+		m_vWorkers[i]->Start( ppX, nBlocks );
+	}
+
+	CLBigNum::ExponentMod( ppY, ppX, nBlocks, m_vChains[1], *m_vMultiBuffers[1] );
+
+	// Garner, as in PKCS #1: first h = qInv * ( m1 - m2 ) mod p, and m = m2 + h * q;
+	// then for each other prime, h = t * ( mi - m ) mod ri, and m += h * ( p * q * ... ).
+
+	for( i = 0; i < knNumPrimes; ++i )
+	{
+		const CMontgomeryContext & kMont = m_vContexts[( i == 0 ) ? 0 : i + 1];
+		const CLBigNum * const * kppResidues = m_vWorkers[i]->Finish();
+
+		for( j = 0; j < nBlocks; ++j )
+		{
+			const CLBigNum & kResidue = *kppResidues[j];
+			CLBigNum & y = *ppY[j];
+
+			mModPrime->Reduce( y, kMont );
+
+			if( kResidue >= *mModPrime )
+			{
+				h->Subtract( kResidue, *mModPrime );
+			}
+			else
+			{
+				h->Add( kResidue, *m_vPrimes[i] );
+				h->Subtract( *h, *mModPrime );
+			}
+
+			h->MultiplyMod( *h, *m_vCoefficients[i], kMont );
+			h->Multiply( *h, *m_vProducts[i] );
+			y.Add( y, *h );
+		}
+	}
+}
+
+
+BigNum CRSAKeyEngine::Apply( const BigNum & x )
+{
+	CLBigNumPtr clX( m_factory );
+	CLBigNumPtr clY( m_factory );
+	BigNum y;
+
+	*clX = x;
+	Apply( *clX, *clY );
+	clY->ToBigNum( y );
+	return( y );
+}
+
+
 // **** End of File ****